@@ -0,0 +1,32 @@
+#include "AllocationCounter.h"
+
+#include "LinearMath/btAlignedAllocator.h"
+
+#include <cstdlib>
+
+AllocationCounter g_allocations;
+
+// Bullet's aligned allocator pads and aligns what these hand back, so
+// they only need to count and pass on to the C runtime like its defaults
+static void* CountingAlloc(size_t size) {
+	g_allocations.Add(size);
+	return malloc(size);
+}
+
+static void CountingFree(void* pMemory) {
+	free(pMemory);
+}
+
+void AllocationCounter::HookBullet() {
+	if (m_bulletHooked)
+		return;
+	btAlignedAllocSetCustom(CountingAlloc, CountingFree);
+	m_bulletHooked = true;
+}
+
+AllocationCounts AllocationCounter::GetCounts() const {
+	AllocationCounts counts;
+	counts.allocations = m_allocations.load(std::memory_order_relaxed);
+	counts.bytes = m_bytes.load(std::memory_order_relaxed);
+	return counts;
+}
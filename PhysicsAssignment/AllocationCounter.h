@@ -0,0 +1,52 @@
+#ifndef _ALLOCATIONCOUNTER_H_
+#define _ALLOCATIONCOUNTER_H_
+
+#include <atomic>
+#include <cstddef>
+
+// heap allocations made so far
+struct AllocationCounts {
+	unsigned long long allocations;
+	unsigned long long bytes;
+
+	AllocationCounts() : allocations(0), bytes(0) {}
+};
+
+// counts heap allocations, so a run can check that once it has settled
+// in, stepping the world allocates nothing. Bullet allocates through
+// btAlignedAlloc, which HookBullet() routes through the counter. The
+// application's own new and delete are counted by linking in
+// CountingNew.cpp, which replaces them, and only the benchmark does.
+//
+// the counters are atomic, since Bullet's worker threads allocate too.
+// The counter relies on being a global, so that it is zeroed before any
+// constructor, and any allocation, runs
+class AllocationCounter {
+public:
+	// count Bullet's allocations from now on. Anything Bullet frees that
+	// it allocated earlier is still freed the same way, with free()
+	void HookBullet();
+	bool IsBulletHooked() const { return m_bulletHooked; }
+
+	// whether CountingNew.cpp is linked in
+	void SetCountingNew() { m_countingNew = true; }
+	bool IsCountingNew() const { return m_countingNew; }
+
+	void Add(size_t bytes) {
+		m_allocations.fetch_add(1, std::memory_order_relaxed);
+		m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	AllocationCounts GetCounts() const;
+
+private:
+	std::atomic<unsigned long long> m_allocations;
+	std::atomic<unsigned long long> m_bytes;
+	bool m_bulletHooked;
+	bool m_countingNew;
+};
+
+// the counter everything reports to
+extern AllocationCounter g_allocations;
+
+#endif
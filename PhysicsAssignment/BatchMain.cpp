@@ -0,0 +1,176 @@
+#include "BatchRunner.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// runs every combination of a grid of domino parameters, each in its own
+// world, across all cores, and writes how each variant went as JSON.
+// Given several worker counts, the whole grid is run at each so the
+// scaling in runs per hour can be compared
+
+// splits "a,b,c" into numbers
+static std::vector<float> SplitFloats(const char* list) {
+	std::vector<float> values;
+	std::string current;
+	for (const char* c = list; ; c++) {
+		if (*c == ',' || *c == 0) {
+			if (!current.empty())
+				values.push_back((float)atof(current.c_str()));
+			current.clear();
+			if (*c == 0)
+				break;
+		} else {
+			current += *c;
+		}
+	}
+	return values;
+}
+
+static void PrintUsage(const char* program) {
+	printf("usage: %s [--layout name] [--count N] [--spacing a,b,...] [--mass a,b,...] [--friction a,b,...] [--force a,b,...] [--workers N,M,...] [--dt seconds] [--max-time seconds] [--out file.json]\n", program);
+	printf("  --layout name     generated layout every run uses (default line)\n");
+	printf("  --count N         dominos per run (default 200)\n");
+	printf("  --spacing list    gaps between dominos to try (default %g)\n", DOMINO_DEFAULT_SPACING);
+	printf("  --mass list       domino masses to try (default %g)\n", DOMINO_MASS);
+	printf("  --friction list   domino frictions to try (default %g)\n", DOMINO_FRICTION);
+	printf("  --force list      push forces to try (default %g)\n", DOMINO_PUSH_FORCE);
+	printf("  --workers list    worker threads, the grid is run once per count (default every hardware thread)\n");
+	printf("  --dt seconds      fixed time step (default 1/60)\n");
+	printf("  --max-time s      simulated seconds before a run gives up (default 30)\n");
+	printf("  --out file.json   where to write the outcomes (default stdout)\n");
+}
+
+static void WriteJSON(FILE* out, const BatchSettings &settings, const std::vector<BatchStats> &passes, const std::vector<BatchOutcome> &outcomes) {
+	fprintf(out, "{\n");
+	fprintf(out, "  \"benchmark\": \"domino_batch\",\n");
+	fprintf(out, "  \"dt\": %g,\n", settings.dt);
+	fprintf(out, "  \"max_time\": %g,\n", settings.maxTime);
+
+	// one entry per worker count, with its throughput and the speedup
+	// over the first count given
+	fprintf(out, "  \"passes\": [\n");
+	for (int i = 0; i < passes.size(); i++) {
+		const BatchStats &stats = passes[i];
+		double runsPerHour = stats.wallMs > 0.0 ? outcomes.size() * 3600000.0 / stats.wallMs : 0.0;
+		double firstPerHour = passes[0].wallMs > 0.0 ? outcomes.size() * 3600000.0 / passes[0].wallMs : 0.0;
+		fprintf(out, "    { \"workers\": %d, \"wall_ms\": %.1f, \"runs_per_hour\": %.0f, \"speedup\": %.3f, \"steals\": %d, \"runs_per_worker\": [",
+			stats.workers, stats.wallMs, runsPerHour, firstPerHour > 0.0 ? runsPerHour / firstPerHour : 0.0, stats.steals);
+		for (int w = 0; w < stats.runsPerWorker.size(); w++)
+			fprintf(out, "%s%d", w > 0 ? ", " : "", stats.runsPerWorker[w]);
+		fprintf(out, "] }%s\n", i + 1 < passes.size() ? "," : "");
+	}
+	fprintf(out, "  ],\n");
+
+	// the outcomes don't depend on the worker count, so only the last
+	// pass's are written
+	fprintf(out, "  \"runs\": [\n");
+	for (int i = 0; i < outcomes.size(); i++) {
+		const BatchOutcome &o = outcomes[i];
+		fprintf(out, "    { \"layout\": \"%s\", \"dominos\": %d, \"spacing\": %g, \"mass\": %g, \"friction\": %g, \"force\": %g, ",
+			o.run.layout.c_str(), o.run.count, o.run.spacing, o.run.params.mass, o.run.params.friction, o.run.params.pushForce);
+		fprintf(out, "\"finished\": %s, \"toppled\": %d, \"first_topple\": %.4f, \"completion_time\": %.4f, \"steps\": %d, \"wall_ms\": %.1f }%s\n",
+			o.finished ? "true" : "false", o.toppled, o.firstTopple, o.completionTime, o.steps, o.wallMs,
+			i + 1 < outcomes.size() ? "," : "");
+	}
+	fprintf(out, "  ]\n");
+	fprintf(out, "}\n");
+}
+
+int main(int argc, char** argv)
+{
+	std::string layoutName = "line";
+	int count = 200;
+	std::vector<float> spacings(1, DOMINO_DEFAULT_SPACING);
+	std::vector<float> masses(1, DOMINO_MASS);
+	std::vector<float> frictions(1, DOMINO_FRICTION);
+	std::vector<float> forces(1, DOMINO_PUSH_FORCE);
+	std::vector<float> workers(1, 0.0f);
+	BatchSettings settings;
+	const char* outputPath = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+			layoutName = argv[++i];
+		} else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+			count = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--spacing") == 0 && i + 1 < argc) {
+			spacings = SplitFloats(argv[++i]);
+		} else if (strcmp(argv[i], "--mass") == 0 && i + 1 < argc) {
+			masses = SplitFloats(argv[++i]);
+		} else if (strcmp(argv[i], "--friction") == 0 && i + 1 < argc) {
+			frictions = SplitFloats(argv[++i]);
+		} else if (strcmp(argv[i], "--force") == 0 && i + 1 < argc) {
+			forces = SplitFloats(argv[++i]);
+		} else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+			workers = SplitFloats(argv[++i]);
+		} else if (strcmp(argv[i], "--dt") == 0 && i + 1 < argc) {
+			settings.dt = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "--max-time") == 0 && i + 1 < argc) {
+			settings.maxTime = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			outputPath = argv[++i];
+		} else {
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	DominoLayout check;
+	if (count < 2 || settings.dt <= 0.0f || settings.maxTime <= 0.0f || workers.empty()
+		|| spacings.empty() || masses.empty() || frictions.empty() || forces.empty()
+		|| !BuildLayoutByName(layoutName, 0, DOMINO_DEFAULT_SPACING, check)) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	// every combination of the parameters
+	std::vector<BatchRun> runs;
+	for (int s = 0; s < spacings.size(); s++) {
+		for (int m = 0; m < masses.size(); m++) {
+			for (int f = 0; f < frictions.size(); f++) {
+				for (int p = 0; p < forces.size(); p++) {
+					BatchRun run;
+					run.layout = layoutName;
+					run.count = count;
+					run.spacing = spacings[s];
+					run.params.mass = masses[m];
+					run.params.friction = frictions[f];
+					run.params.pushForce = forces[p];
+					runs.push_back(run);
+				}
+			}
+		}
+	}
+
+	std::vector<BatchStats> passes;
+	std::vector<BatchOutcome> outcomes;
+	for (int i = 0; i < workers.size(); i++) {
+		BatchRunner runner((int)workers[i]);
+		fprintf(stderr, "running %d variants of %s x %d...\n", (int)runs.size(), layoutName.c_str(), count);
+		runner.Run(runs, settings, outcomes);
+
+		const BatchStats &stats = runner.GetStats();
+		fprintf(stderr, "%d workers: %.1f s, %.0f runs per hour, %d steals\n", stats.workers, stats.wallMs / 1000.0,
+			stats.wallMs > 0.0 ? runs.size() * 3600000.0 / stats.wallMs : 0.0, stats.steals);
+		passes.push_back(stats);
+	}
+
+	FILE* out = stdout;
+	if (outputPath) {
+		out = fopen(outputPath, "w");
+		if (!out) {
+			fprintf(stderr, "could not open '%s' for writing\n", outputPath);
+			return 1;
+		}
+	}
+
+	WriteJSON(out, settings, passes, outcomes);
+
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}
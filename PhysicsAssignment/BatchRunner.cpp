@@ -0,0 +1,158 @@
+#include "BatchRunner.h"
+#include "LayoutSimulation.h"
+
+#include "LinearMath/btQuickprof.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// one worker's queue of run indices. Owners and thieves both lock it,
+// but a run takes far longer than the lock, so it is never contended
+struct WorkQueue {
+	std::mutex mutex;
+	std::deque<int> runs;
+};
+
+BatchRunner::BatchRunner(int workers)
+:
+m_workers(workers)
+{
+	if (m_workers <= 0)
+		m_workers = (int)std::thread::hardware_concurrency();
+	if (m_workers <= 0)
+		m_workers = 1;
+}
+
+// stand in for Bullet's profile zones while the workers step
+static void EnterNoZone(const char*) {}
+static void LeaveNoZone() {}
+
+BatchOutcome BatchRunner::RunOne(const BatchRun &run, const BatchSettings &settings) {
+	btClock clock;
+
+	BatchOutcome outcome;
+	outcome.run = run;
+	outcome.finished = false;
+	outcome.toppled = 0;
+	outcome.firstTopple = -1.0f;
+	outcome.completionTime = -1.0f;
+	outcome.steps = 0;
+	outcome.worker = 0;
+
+	DominoLayout layout;
+	if (run.count < 2 || !BuildLayoutByName(run.layout, run.count, run.spacing, layout)) {
+		outcome.wallMs = 0.0;
+		return outcome;
+	}
+
+	LayoutSimulation simulation(layout);
+	simulation.SetDominoParams(run.params);
+	simulation.Initialize();
+
+	ToppleTracker topple(&simulation);
+
+	int maxSteps = (int)(settings.maxTime / settings.dt + 0.5f);
+	while (outcome.steps < maxSteps && !topple.IsComplete()) {
+		// a maxSubSteps of 0 makes Bullet step by exactly dt
+		simulation.UpdateScene(settings.dt, 0);
+		outcome.steps++;
+		topple.Update(outcome.steps * settings.dt);
+
+		// once the chain has started and everything has settled,
+		// nothing else is going to fall
+		if (topple.GetNumToppled() > 0 && simulation.IsAtRest())
+			break;
+	}
+
+	outcome.toppled = topple.GetNumToppled();
+	outcome.firstTopple = topple.GetFirstTopple();
+	outcome.completionTime = topple.GetCompletionTime();
+	outcome.finished = topple.IsComplete();
+	outcome.wallMs = clock.getTimeMicroseconds() / 1000.0;
+	return outcome;
+}
+
+void BatchRunner::Run(const std::vector<BatchRun> &runs, const BatchSettings &settings, std::vector<BatchOutcome> &outcomes) {
+	btClock clock;
+
+	outcomes.resize(runs.size());
+	m_stats = BatchStats();
+	m_stats.workers = m_workers;
+	m_stats.runsPerWorker.assign(m_workers, 0);
+
+	// whatever was profiling before, such as the frame profiler, gets
+	// its hooks back afterwards
+	btEnterProfileZoneFunc* pEnterZone = btGetCurrentEnterProfileZoneFunc();
+	btLeaveProfileZoneFunc* pLeaveZone = btGetCurrentLeaveProfileZoneFunc();
+	btSetCustomEnterProfileZoneFunc(EnterNoZone);
+	btSetCustomLeaveProfileZoneFunc(LeaveNoZone);
+
+	// deal the runs out round robin
+	std::vector<WorkQueue> queues(m_workers);
+	for (int i = 0; i < (int)runs.size(); i++)
+		queues[i % m_workers].runs.push_back(i);
+
+	std::mutex statsMutex;
+
+	struct Worker {
+		static void Loop(int self, std::vector<WorkQueue>* pQueues, const std::vector<BatchRun>* pRuns, const BatchSettings* pSettings,
+			std::vector<BatchOutcome>* pOutcomes, BatchStats* pStats, std::mutex* pStatsMutex) {
+			std::vector<WorkQueue> &queues = *pQueues;
+			int numQueues = (int)queues.size();
+			int completed = 0;
+			int steals = 0;
+
+			for (;;) {
+				int index = -1;
+
+				// our own newest first
+				{
+					std::lock_guard<std::mutex> lock(queues[self].mutex);
+					if (!queues[self].runs.empty()) {
+						index = queues[self].runs.back();
+						queues[self].runs.pop_back();
+					}
+				}
+
+				// then the oldest of the next worker along that has any.
+				// Nothing adds runs once they are dealt out, so when every
+				// queue is empty the batch is done
+				for (int i = 1; index < 0 && i < numQueues; i++) {
+					WorkQueue &victim = queues[(self + i) % numQueues];
+					std::lock_guard<std::mutex> lock(victim.mutex);
+					if (!victim.runs.empty()) {
+						index = victim.runs.front();
+						victim.runs.pop_front();
+						steals++;
+					}
+				}
+				if (index < 0)
+					break;
+
+				BatchOutcome &outcome = (*pOutcomes)[index];
+				outcome = RunOne((*pRuns)[index], *pSettings);
+				outcome.worker = self;
+				completed++;
+			}
+
+			std::lock_guard<std::mutex> lock(*pStatsMutex);
+			pStats->runsPerWorker[self] = completed;
+			pStats->steals += steals;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < m_workers; i++)
+		threads.push_back(std::thread(Worker::Loop, i, &queues, &runs, &settings, &outcomes, &m_stats, &statsMutex));
+
+	// the calling thread is worker 0
+	Worker::Loop(0, &queues, &runs, &settings, &outcomes, &m_stats, &statsMutex);
+	for (int i = 0; i < threads.size(); i++)
+		threads[i].join();
+
+	btSetCustomEnterProfileZoneFunc(pEnterZone);
+	btSetCustomLeaveProfileZoneFunc(pLeaveZone);
+
+	m_stats.wallMs = clock.getTimeMicroseconds() / 1000.0;
+}
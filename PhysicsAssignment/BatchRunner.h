@@ -0,0 +1,77 @@
+#ifndef _BATCHRUNNER_H_
+#define _BATCHRUNNER_H_
+
+#include "DominoLayout.h"
+#include "PhysicsSimulation.h"
+
+#include <string>
+#include <vector>
+
+// one variant of a domino run
+struct BatchRun {
+	std::string layout;		// a BuildLayoutByName() name
+	int count;				// dominos in the layout
+	float spacing;
+	DominoParams params;
+};
+
+// how a run went
+struct BatchOutcome {
+	BatchRun run;
+	bool finished;			// every domino fell
+	int toppled;			// how many dominos fell
+	float firstTopple;		// simulated seconds until the first domino fell, or -1
+	float completionTime;	// simulated seconds until the last domino to fall fell, or -1
+	int steps;
+	double wallMs;
+	int worker;				// which worker ran it
+};
+
+// how long each run may go on for
+struct BatchSettings {
+	float dt;				// fixed step
+	float maxTime;			// simulated seconds before giving up on a chain
+
+	BatchSettings() : dt(1.0f / 60.0f), maxTime(30.0f) {}
+};
+
+// how the work was shared out
+struct BatchStats {
+	int workers;
+	std::vector<int> runsPerWorker;
+	int steals;				// runs a worker took from another's queue
+	double wallMs;
+
+	BatchStats() : workers(0), steals(0), wallMs(0.0) {}
+};
+
+// runs many independent simulations at once, one per worker thread. Each
+// run builds its own world, so nothing is shared between threads but the
+// queues. The runs start dealt out evenly between per-worker queues; a
+// worker takes from the back of its own queue and, when that runs dry,
+// steals from the front of someone else's, so a worker stuck with slow
+// variants doesn't hold the batch up while the others sit idle.
+//
+// each world steps on a single thread. Bullet's default profile zones
+// keep one shared tree and are not meant to be entered from many threads
+// at once, so while a batch runs they are swapped for hooks that do
+// nothing
+class BatchRunner {
+public:
+	// 0 workers uses every hardware thread
+	BatchRunner(int workers = 0);
+
+	// run every variant and fill outcomes in the same order as runs
+	void Run(const std::vector<BatchRun> &runs, const BatchSettings &settings, std::vector<BatchOutcome> &outcomes);
+
+	const BatchStats& GetStats() const { return m_stats; }
+
+	// run one variant on the calling thread
+	static BatchOutcome RunOne(const BatchRun &run, const BatchSettings &settings);
+
+private:
+	int m_workers;
+	BatchStats m_stats;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include "BroadphaseFactory.h"
+
+#include <cstring>
+
+// bodies topple and roll a little way from where they start, so the
+// sweep and prune bounds are grown by this much all round. Anything that
+// gets further still works, just less efficiently
+#define BOUNDS_PADDING 8.0f
+
+// btAxisSweep3's handles are 16 bit, and it can't have more than this
+#define MAX_16BIT_HANDLES 32766
+
+static const char* s_broadphaseNames[NUM_BROADPHASE_TYPES] = {
+	"dbvt",
+	"sap"
+};
+
+const char* GetBroadphaseName(BroadphaseType type) {
+	return type >= 0 && type < NUM_BROADPHASE_TYPES ? s_broadphaseNames[type] : "unknown";
+}
+
+bool ParseBroadphaseName(const char* name, BroadphaseType &type) {
+	for (int i = 0; i < NUM_BROADPHASE_TYPES; i++) {
+		if (strcmp(name, s_broadphaseNames[i]) == 0) {
+			type = (BroadphaseType)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+btHashedOverlappingPairCache* CreatePairCache(int pairs) {
+	btHashedOverlappingPairCache* pCache = new btHashedOverlappingPairCache();
+	if (pairs <= 0)
+		return pCache;
+
+	// the cache only grows its hash table along with its pair array, and
+	// won't be told to do either, so it is made to by adding as many
+	// pairs as are wanted and taking them all away again. The pairs come
+	// from every combination of a few made up proxies, just enough of them
+	int numProxies = 2;
+	while (numProxies * (numProxies - 1) / 2 < pairs)
+		numProxies++;
+
+	btAlignedObjectArray<btBroadphaseProxy> proxies;
+	proxies.resize(numProxies);
+	for (int i = 0; i < numProxies; i++) {
+		proxies[i].m_clientObject = 0;
+		proxies[i].m_collisionFilterGroup = btBroadphaseProxy::DefaultFilter;
+		proxies[i].m_collisionFilterMask = btBroadphaseProxy::AllFilter;
+		proxies[i].m_uniqueId = i;
+	}
+
+	int added = 0;
+	for (int i = 0; i < numProxies && added < pairs; i++) {
+		for (int j = i + 1; j < numProxies && added < pairs; j++, added++)
+			pCache->addOverlappingPair(&proxies[i], &proxies[j]);
+	}
+
+	// none of them have collision algorithms, so no dispatcher is needed
+	while (pCache->getNumOverlappingPairs() > 0) {
+		btBroadphasePair &pair = pCache->getOverlappingPairArray()[pCache->getNumOverlappingPairs() - 1];
+		pCache->removeOverlappingPair(pair.m_pProxy0, pair.m_pProxy1, 0);
+	}
+	return pCache;
+}
+
+btBroadphaseInterface* CreateBroadphase(BroadphaseType type, const btVector3 &boundsMin, const btVector3 &boundsMax, int numBodies, btOverlappingPairCache* pPairCache, bool aabbQueries) {
+	if (type == BROADPHASE_SAP) {
+		btVector3 padding(BOUNDS_PADDING, BOUNDS_PADDING, BOUNDS_PADDING);
+		btVector3 worldMin = boundsMin - padding;
+		btVector3 worldMax = boundsMax + padding;
+
+		// room for bodies added later, such as anything the
+		// application throws in. Without the tree Bullet can keep
+		// alongside, rays and box queries test every handle, so it is
+		// left out unless something needs them
+		int handles = numBodies + numBodies / 8 + 16;
+		bool noQueryTree = !aabbQueries;
+		if (handles <= MAX_16BIT_HANDLES)
+			return new btAxisSweep3(worldMin, worldMax, (unsigned short)handles, pPairCache, noQueryTree);
+		return new bt32BitAxisSweep3(worldMin, worldMax, (unsigned int)handles, pPairCache, noQueryTree);
+	}
+	return new btDbvtBroadphase(pPairCache);
+}
@@ -0,0 +1,42 @@
+#ifndef _BROADPHASEFACTORY_H_
+#define _BROADPHASEFACTORY_H_
+
+#include "btBulletDynamicsCommon.h"
+
+// the broadphases a simulation can be built with
+enum BroadphaseType {
+	BROADPHASE_DBVT,	// Bullet's default dynamic AABB trees. Needs no bounds
+	BROADPHASE_SAP,		// sweep and prune over fixed world bounds
+	NUM_BROADPHASE_TYPES
+};
+
+struct BroadphaseSettings {
+	BroadphaseType type;
+	// overlapping pairs to make room for per body up front. This also
+	// sizes the collision configuration's pools of contact manifolds and
+	// collision algorithms, of which each pair has at most one
+	int pairsPerBody;
+
+	// a domino overlaps the ground and, once fallen, the next domino
+	BroadphaseSettings() : type(BROADPHASE_DBVT), pairsPerBody(2) {}
+};
+
+// "dbvt" or "sap"
+const char* GetBroadphaseName(BroadphaseType type);
+
+// the other way round. Returns false, leaving type alone, if the name is unknown
+bool ParseBroadphaseName(const char* name, BroadphaseType &type);
+
+// a hashed pair cache with room for pairs pairs. Bullet grows the cache
+// by reallocating its pair array and rehashing every time the array
+// fills, which a big scene otherwise does over its first few steps
+btHashedOverlappingPairCache* CreatePairCache(int pairs);
+
+// a broadphase of the given type for about numBodies bodies starting out
+// between boundsMin and boundsMax, using pPairCache, which it doesn't
+// take over. Sweep and prune gets 16 bit handles while they are enough
+// and 32 bit ones beyond that. With aabbQueries, rays and box queries
+// are kept fast, rather than going through every body
+btBroadphaseInterface* CreateBroadphase(BroadphaseType type, const btVector3 &boundsMin, const btVector3 &boundsMax, int numBodies, btOverlappingPairCache* pPairCache, bool aabbQueries = false);
+
+#endif
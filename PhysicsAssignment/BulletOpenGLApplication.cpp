@@ -1,5 +1,7 @@
 #include "BulletOpenGLApplication.h"
 
+#include <cstdio>
+
 // Some constants for 3D math and the camera speed
 #define RADIANS_PER_DEGREE 0.01745329f
 #define CAMERA_STEP_SIZE 5.0f
@@ -16,20 +18,44 @@ m_cameraYaw(70.0f),
 m_upVector(0.0f, 1.0f, 0.0f),
 m_nearPlane(1.0f),
 m_farPlane(1000.0f),
-m_pBroadphase(0),
-m_pCollisionConfiguration(0),
-m_pDispatcher(0),
-m_pSolver(0),
-m_pWorld(0)
+m_screenWidth(0),
+m_screenHeight(0),
+m_pSimulation(0),
+m_culling(true),
+m_recordPath(0),
+m_paused(false),
+m_usePhysicsThread(false),
+m_showProfile(false)
 {
 }
 
 BulletOpenGLApplication::~BulletOpenGLApplication() {
-	delete m_pWorld;
-	delete m_pSolver;
-	delete m_pBroadphase;
-	delete m_pDispatcher;
-	delete m_pCollisionConfiguration;
+	// the physics thread may be in the middle of a step
+	m_physicsThread.Stop();
+
+	if (m_recorder.IsOpen()) {
+		const TrajectoryStats &stats = m_recorder.GetStats();
+		printf("recorded %d frames, %u body records, %llu bytes\n", stats.frames, stats.bodyRecords, stats.bytes);
+		m_recorder.Close();
+	}
+	delete m_pSimulation;
+}
+
+bool BulletOpenGLApplication::LoadRecording(const char* path) {
+	return m_player.Open(path);
+}
+
+bool BulletOpenGLApplication::LoadScene(const char* path) {
+	if (!m_scene.Open(path))
+		return false;
+
+	// the game logic pushes the first domino until it hits the second
+	if (m_scene.GetNumDominos() < 2) {
+		printf("scene file '%s' needs at least two dominos\n", path);
+		m_scene.Close();
+		return false;
+	}
+	return true;
 }
 
 void BulletOpenGLApplication::Initialize() {
@@ -67,43 +93,125 @@ void BulletOpenGLApplication::Initialize() {
 	// set the backbuffer clearing color to a lightish blue
 	glClearColor(0.6, 0.65, 0.85, 0);
 
-	// create the collision configuration
-	m_pCollisionConfiguration = new btDefaultCollisionConfiguration();
-	// create the dispatcher
-	m_pDispatcher = new btCollisionDispatcher(m_pCollisionConfiguration);
-	// create the broadphase
-	m_pBroadphase = new btDbvtBroadphase();
-	// create the constraint solver
-	m_pSolver = new btSequentialImpulseConstraintSolver();
-	// create the world
-	m_pWorld = new btDiscreteDynamicsWorld(m_pDispatcher, m_pBroadphase, m_pSolver, m_pCollisionConfiguration);
-
-	// create a ground plane
-	CreateGameObject(new btBoxShape(btVector3(1,50,50)), 0, btVector3(0.2f, 0.6f, 0.6f), btVector3(0.0f, 0.0f, 0.0f));
-
-	// create our scene's physics objects
-	CreateObjects();
-
-	reset = 0;
-	start = 0;
+	// set up instanced box drawing. If the driver can't do it
+	// RenderScene() falls back to drawing each box in immediate mode
+	m_boxRenderer.Initialize();
+
+	// create the world, the ground plane and our scene's physics objects
+	if (m_scene.IsOpen())
+		m_pSimulation = new SceneSimulation(m_scene);
+	else
+		m_pSimulation = new PhysicsSimulation();
+	m_pSimulation->SetWavefront(m_wavefront);
+	m_pSimulation->SetBroadphase(m_broadphase);
+	m_pSimulation->SetSolver(m_solver);
+	m_pSimulation->SetCcd(m_ccd);
+	m_pSimulation->Initialize();
+
+	// a recording only fits the scene it was made from
+	if (m_player.IsOpen() && m_player.GetNumBodies() != m_pSimulation->GetEntities().GetNumEntities()) {
+		printf("the recording has %d bodies but the scene has %d, so it won't be played\n",
+			m_player.GetNumBodies(), m_pSimulation->GetEntities().GetNumEntities());
+		m_player.Close();
+	}
+
+	if (m_recordPath && !m_player.IsOpen() && m_recorder.Open(m_recordPath, m_pSimulation->GetEntities()))
+		m_pSimulation->SetRecorder(&m_recorder);
+
+	// from here on the physics thread owns the world
+	if (m_usePhysicsThread && !m_player.IsOpen())
+		m_physicsThread.Start(m_pSimulation, m_timeStep.GetSettings());
 }
 
 void BulletOpenGLApplication::Keyboard(unsigned char key, int x, int y) {
 
 	switch(key) {
-	// if r is pressed
+	// if r is pressed, put the dominos back up, or rewind the recording
 	case 'r':
-		if(reset == 0)
+		if (m_player.IsOpen())
+			m_player.Seek(0.0f);
+		else if (m_physicsThread.IsRunning())
+			m_physicsThread.RequestReset();
+		else {
+			m_pSimulation->Reset();
+			m_timeStep.Reset();
+		}
+		break;
+	// p pauses, and while playing back [ and ] skip a second either way
+	case 'p':
+		m_paused = !m_paused;
+		m_physicsThread.SetPaused(m_paused);
+		break;
+	case '[':
+	case ']':
+		if (m_player.IsOpen()) {
+			m_player.Seek(m_player.GetTime() + (key == ']' ? 1.0f : -1.0f));
+			printf("playback at %.2f of %.2f s\n", m_player.GetTime(), m_player.GetDuration());
+		}
+		break;
+	// if c is pressed, report how the mesh cache is doing
+	case 'c':
+		{
+			const MeshCacheStats &stats = m_meshCache.GetStats();
+			printf("mesh cache: %d/%d meshes, %u hits, %u misses, %u evictions, %u bytes\n",
+				stats.entries, stats.maxEntries, stats.hits, stats.misses, stats.evictions, (unsigned int)stats.bytes);
+		}
+		break;
+	// + and - trade detail for frame time, l reports what the
+	// last frame drew
+	case '+':
+	case '-':
+		m_lod.SetQuality(key == '+' ? m_lod.GetQuality() * 1.25f : m_lod.GetQuality() / 1.25f);
+		printf("detail quality %.2f\n", m_lod.GetQuality());
+		break;
+	case 'l':
+		{
+			const LodStats &stats = GetLodStats();
+			printf("%d triangles: %d full, %d medium, %d low, %d impostor, %d hidden\n",
+				stats.triangles, stats.objects[LOD_FULL], stats.objects[LOD_MEDIUM],
+				stats.objects[LOD_LOW], stats.objects[LOD_IMPOSTOR], stats.objects[LOD_HIDDEN]);
+		}
+		break;
+	// o shows the frame profiler, which also turns it on, and e
+	// saves the frames it holds
+	case 'o':
+		m_showProfile = !m_showProfile;
+		g_profiler.SetEnabled(m_showProfile);
+		break;
+	case 'e':
+		if (g_profiler.GetNumFrames() == 0) {
+			printf("no frames profiled yet, press o to start\n");
+		} else if (g_profiler.ExportCsv("profile.csv") && g_profiler.ExportJson("profile.json")) {
+			printf("saved %d profiled frames to profile.csv and profile.json\n", g_profiler.GetNumFrames());
+		} else {
+			printf("could not save the profile\n");
+		}
+		break;
+	// if t is pressed, switch between a fixed and an adaptive time step
+	case 't':
 		{
-			// reset = 1; so the physics world doesnt try update the domino bodies while deleteing them
-			reset = 1;
-
-			// remove domino body from world and remove domino from list
-			for(int i = 0; i < dominos.size(); i++)
-			{
-				m_pWorld->removeRigidBody(dominos.at(i)->GetRigidBody());
-				dominos.at(i)->~Domino();
+			TimeStepSettings settings = m_timeStep.GetSettings();
+			settings.mode = settings.mode == TIMESTEP_ADAPTIVE ? TIMESTEP_FIXED : TIMESTEP_ADAPTIVE;
+			m_timeStep.SetSettings(settings);
+
+			// the stats are whichever controller has been doing the stepping
+			TimeStepStats stats = m_timeStep.GetStats();
+			if (m_physicsThread.IsRunning()) {
+				m_physicsThread.SetTimeStep(settings);
+				stats = m_physicsThread.GetTimeStepStats();
 			}
+			printf("%s time step (so far: %u steps over %u frames, %u frames clamped, %.2f s dropped, %.0f%% load)\n",
+				settings.mode == TIMESTEP_ADAPTIVE ? "adaptive" : "fixed", stats.steps, stats.frames,
+				stats.clampedFrames, stats.droppedTime, stats.load * 100.0f);
+		}
+		break;
+	// if f is pressed, turn frustum culling on or off
+	case 'f':
+		{
+			m_culling = !m_culling;
+			const CullStats &stats = GetCullStats();
+			printf("frustum culling %s (last frame: %d drawn, %d culled)\n",
+				m_culling ? "on" : "off", stats.visible, stats.culled);
 		}
 		break;
 	}
@@ -114,24 +222,155 @@ void BulletOpenGLApplication::Idle() {
 	// isn't busy processing its own events. It should be used
 	// to perform any updating and rendering tasks
 
+	// get the time since the last iteration. Whole milliseconds
+	// would round every frame's time one way or the other
+	float dt = m_clock.getTimeMicroseconds();
+	// reset the clock to 0
+	m_clock.reset();
+	// update and draw the scene (convert us to s)
+	RenderFrame(dt / 1000000.0f);
+
+	if (m_showProfile)
+		DrawProfileOverlay();
+
+	// swap the front and back buffers
+	{
+		PROFILE_PHASE(PHASE_SWAP);
+		glutSwapBuffers();
+	}
+	g_profiler.EndFrame();
+}
+
+void BulletOpenGLApplication::Reshape(int width, int height) {
+	m_screenWidth = width;
+	m_screenHeight = height;
+
+	// draw to the whole window
+	glViewport(0, 0, width, height);
+}
+
+void BulletOpenGLApplication::RenderFrame(float dt) {
 	// clear the backbuffer
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); 
 
-	// get the time since the last iteration
-	float dt = m_clock.getTimeMilliseconds();
-	// reset the clock to 0
-	m_clock.reset();
-	// update the scene (convert ms to s)
-	UpdateScene(dt / 1000.0f);
+	// update the scene
+	UpdateScene(dt);
 
 	// update the camera
-	UpdateCamera();
+	{
+		PROFILE_PHASE(PHASE_CAMERA);
+		UpdateCamera();
+	}
 
 	// render the scene
-	RenderScene();
+	{
+		PROFILE_PHASE(PHASE_RENDER);
+		RenderScene();
+	}
+}
 
-	// swap the front and back buffers
-	glutSwapBuffers();
+void BulletOpenGLApplication::DrawProfileOverlay() {
+	ProfileFrame average;
+	g_profiler.GetAverage(60, average);
+
+	// draw in window coordinates, unlit, over everything
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, m_screenWidth, 0, m_screenHeight, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+
+	glColor3f(0.0f, 0.0f, 0.0f);
+	int y = m_screenHeight - 20;
+	for (int i = 0; i < NUM_PROFILE_PHASES; i++, y -= 15) {
+		char line[64];
+		sprintf(line, "%-17s %7.2f ms", FrameProfiler::GetPhaseName((ProfilePhase)i), average.ms[i]);
+		glRasterPos2i(10, y);
+		glutBitmapString(GLUT_BITMAP_8_BY_13, (const unsigned char*)line);
+	}
+
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_LIGHTING);
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
+
+bool BulletOpenGLApplication::RunOffscreen(const char* prefix, int width, int height, int frames) {
+	OffscreenContext context;
+	if (!context.Create(width, height))
+		return false;
+
+	// every frame is one fixed step, so the world is stepped in step
+	// with the frames rather than on a thread of its own, and each frame
+	// shows exactly where the step left everything
+	SetPhysicsThread(false);
+	TimeStepSettings settings = m_timeStep.GetSettings();
+	settings.mode = TIMESTEP_FIXED;
+	settings.step = 1.0f / 60.0f;
+	settings.interpolate = false;
+	m_timeStep.SetSettings(settings);
+	Initialize();
+	Reshape(width, height);
+
+	FrameCapture capture;
+	if (!capture.Start(prefix, width, height)) {
+		printf("could not start capturing frames of %dx%d\n", width, height);
+		return false;
+	}
+
+	// time the loop the way a window would see it, then how long the
+	// writer takes to catch up once rendering is done
+	btClock clock;
+	unsigned long long renderMicroseconds = 0;
+	unsigned long long captureMicroseconds = 0;
+	for (int i = 0; i < frames; i++) {
+		unsigned long long start = clock.getTimeMicroseconds();
+		RenderFrame(1.0f / 60.0f);
+		unsigned long long rendered = clock.getTimeMicroseconds();
+		capture.CaptureFrame();
+		unsigned long long captured = clock.getTimeMicroseconds();
+
+		renderMicroseconds += rendered - start;
+		captureMicroseconds += captured - rendered;
+	}
+	unsigned long long loopMicroseconds = clock.getTimeMicroseconds();
+	capture.Finish();
+	unsigned long long totalMicroseconds = clock.getTimeMicroseconds();
+
+	CaptureStats stats = capture.GetStats();
+	double loopSeconds = loopMicroseconds / 1000000.0;
+	double totalSeconds = totalMicroseconds / 1000000.0;
+	printf("rendered %d frames of %dx%d with %d bodies\n", frames, width, height, m_pSimulation->GetEntities().GetNumEntities());
+	printf("render loop:  %.3f s, %.1f fps (%.2f ms rendering, %.2f ms capturing per frame)\n",
+		loopSeconds, loopSeconds > 0.0 ? frames / loopSeconds : 0.0,
+		frames ? renderMicroseconds / 1000.0 / frames : 0.0, frames ? captureMicroseconds / 1000.0 / frames : 0.0);
+	printf("with writing: %.3f s, %.1f fps, %d frames written, %llu bytes, %d stalls waiting for the writer\n",
+		totalSeconds, totalSeconds > 0.0 ? stats.framesWritten / totalSeconds : 0.0,
+		stats.framesWritten, stats.bytesWritten, stats.stalls);
+	return true;
+}
+
+// what gluLookAt() does, built here so the camera only needs OpenGL
+// itself. GLU always calls the system's opengl32.dll, which isn't the
+// implementation doing the drawing in an OSMesa build
+static void LookAt(const btVector3 &eye, const btVector3 &target, const btVector3 &up) {
+	btVector3 forward = (target - eye).normalized();
+	btVector3 side = forward.cross(up).normalized();
+	btVector3 trueUp = side.cross(forward);
+
+	GLfloat matrix[16] = {
+		side.x(), trueUp.x(), -forward.x(), 0.0f,
+		side.y(), trueUp.y(), -forward.y(), 0.0f,
+		side.z(), trueUp.z(), -forward.z(), 0.0f,
+		-side.dot(eye), -trueUp.dot(eye), forward.dot(eye), 1.0f
+	};
+	glMultMatrixf(matrix);
 }
 
 void BulletOpenGLApplication::UpdateCamera() {
@@ -199,11 +438,18 @@ void BulletOpenGLApplication::UpdateCamera() {
 
 	// create a view matrix based on the camera's position and where it's
 	// looking
-	gluLookAt(m_cameraPosition[0], m_cameraPosition[1], m_cameraPosition[2], m_cameraTarget[0], m_cameraTarget[1], m_cameraTarget[2], m_upVector.getX(), m_upVector.getY(), m_upVector.getZ());
+	LookAt(m_cameraPosition, m_cameraTarget, m_upVector);
 	// the view matrix is now set
+
+	// keep the culling frustum in step with the projection. glFrustum
+	// above spans aspectRatio * near across and near up, at near
+	m_frustum.Set(m_cameraPosition, m_cameraTarget, m_upVector, aspectRatio, 1.0f, m_nearPlane, m_farPlane);
+
+	// and the detail selection, which measures sizes in pixels
+	m_lod.SetView(m_cameraPosition, m_screenHeight, 1.0f);
 }
 
-void BulletOpenGLApplication::DrawBox(const btVector3 &halfSize) {
+int BulletOpenGLApplication::DrawBox(const btVector3 &halfSize) {
 	
 	float halfWidth = halfSize.x();
 	float halfHeight = halfSize.y();
@@ -270,62 +516,171 @@ void BulletOpenGLApplication::DrawBox(const btVector3 &halfSize) {
 
 	// stop processing vertices
 	glEnd();
+	return 12;
 }
 
-void BulletOpenGLApplication::RenderScene() {
-	// create an array of 16 floats (representing a 4x4 matrix)
-	btScalar transform[16];
+int BulletOpenGLApplication::DrawCard(const btVector3 &halfSize) {
+	// a box seen from far enough away is just its two broad faces.
+	// Only a box thinnest along z looks right drawn this way
+	if (halfSize.minAxis() != 2)
+		return DrawBox(halfSize);
 
-	// as long as we arent trying to delete the objects you can draw them
-	if(reset == 0)
-	{
-		for(int i = 0; i < dominos.size(); i++)
+	float halfWidth = halfSize.x();
+	float halfHeight = halfSize.y();
+	float halfDepth = halfSize.z();
+
+	glBegin(GL_QUADS);
+	glNormal3f(0, 0, 1);
+	glVertex3f(halfWidth, halfHeight, halfDepth);
+	glVertex3f(-halfWidth, halfHeight, halfDepth);
+	glVertex3f(-halfWidth, -halfHeight, halfDepth);
+	glVertex3f(halfWidth, -halfHeight, halfDepth);
+
+	glNormal3f(0, 0, -1);
+	glVertex3f(halfWidth, halfHeight, -halfDepth);
+	glVertex3f(halfWidth, -halfHeight, -halfDepth);
+	glVertex3f(-halfWidth, -halfHeight, -halfDepth);
+	glVertex3f(-halfWidth, halfHeight, -halfDepth);
+	glEnd();
+	return 4;
+}
+
+// the radius of a sphere around the shape, for picking its detail
+static btScalar GetBoundingRadius(const btCollisionShape* pShape) {
+	switch(pShape->getShapeType()) {
+	case BOX_SHAPE_PROXYTYPE:
+		return static_cast<const btBoxShape*>(pShape)->getHalfExtentsWithMargin().length();
+	case CYLINDER_SHAPE_PROXYTYPE:
 		{
-			dominos.at(i)->GetTransform(transform);
-			DrawShape(transform, dominos.at(i)->GetShape(), dominos.at(i)->GetColor(), dominos.at(i)->rotation);
+			const btCylinderShape* pCylinder = static_cast<const btCylinderShape*>(pShape);
+			btScalar radius = pCylinder->getRadius();
+			btScalar halfHeight = pCylinder->getHalfExtentsWithMargin()[1];
+			return btSqrt(radius * radius + halfHeight * halfHeight);
 		}
-
-		for(int i = 0; i < m_objects.size(); i++)
+	default:
 		{
-			m_objects.at(i)->GetTransform(transform);
-			DrawShape(transform, m_objects.at(i)->GetShape(), m_objects.at(i)->GetColor(), 0.0f);
+			btVector3 centre;
+			btScalar radius;
+			pShape->getBoundingSphere(centre, radius);
+			return radius;
 		}
 	}
 }
 
-void BulletOpenGLApplication::UpdateScene(float dt) {
+void BulletOpenGLApplication::RenderScene() {
+	// without instancing, draw everything one shape at a time
+	bool instanced = m_boxRenderer.IsAvailable();
+	if (instanced)
+		m_boxRenderer.Begin();
+
+	EntityStore &entities = m_pSimulation->GetEntities();
+	m_visibleMatrices.clear();
+
+	if (m_physicsThread.IsRunning()) {
+		// the world is the physics thread's, so neither the bodies nor
+		// the broadphase can be looked at. Everything is drawn between
+		// the last two published steps instead, and culled by bounding
+		// sphere against those positions
+		m_physicsThread.Interpolate();
+		m_visible.clear();
+		for (int i = 0; i < entities.GetNumEntities(); i++) {
+			const btScalar* matrix = m_physicsThread.GetMatrix(i);
+			if (m_culling) {
+				btVector3 centre(matrix[12], matrix[13], matrix[14]);
+				btScalar radius = GetBoundingRadius(entities.GetEntity(i).pShape);
+				btVector3 extent(radius, radius, radius);
+				if (!m_frustum.Intersects(centre - extent, centre + extent))
+					continue;
+			}
+			m_visible.push_back(&entities.GetEntity(i));
+			m_visibleMatrices.push_back(matrix);
+		}
+	} else {
+		// only the bodies that moved since the last frame need
+		// their matrices rebuilt. The rest reuse their cached ones
+		entities.UpdateDirtyTransforms();
+
+		// find what the camera can see, or take everything with culling off
+		if (m_culling) {
+			// played back bodies are never put back in the broadphase, so
+			// without it the culler tests each body's own bounds instead
+			btBroadphaseInterface* pBroadphase = m_player.IsOpen() ? 0 : m_pSimulation->GetBroadphase();
+			m_culler.Cull(pBroadphase, m_frustum, entities, m_visible);
+		} else {
+			m_visible.clear();
+			for (int i = 0; i < entities.GetNumEntities(); i++)
+				m_visible.push_back(&entities.GetEntity(i));
+		}
+		for (int i = 0; i < m_visible.size(); i++)
+			m_visibleMatrices.push_back(entities.GetMatrix(*m_visible[i]));
+	}
 
-	// as long as we arent trying to delete the objects
-	if(reset == 0)
+	// only what is on screen reaches the draw calls, each with as much
+	// detail as its size on screen calls for
+	m_lodStats.Reset();
+	for(int i = 0; i < m_visible.size(); i++)
 	{
-		// check if the world object exists
-		if (m_pWorld) {
-			// step the simulation through time. This is called
-			// every update and the amount of elasped time was 
-			// determined back in ::Idle() by our clock object.
-			m_pWorld->stepSimulation(dt);
-		}
+		const Entity &entity = *m_visible[i];
+		const btScalar* transform = m_visibleMatrices[i];
+
+		btVector3 centre(transform[12], transform[13], transform[14]);
+		LodLevel lod = m_lod.Select(centre, GetBoundingRadius(entity.pShape));
+		m_lodStats.objects[lod]++;
+		if (lod == LOD_HIDDEN)
+			continue;
+
+		if (instanced && entity.pShape->getShapeType() == BOX_SHAPE_PROXYTYPE)
+			m_boxRenderer.AddBox(transform, static_cast<const btBoxShape*>(entity.pShape)->getHalfExtentsWithMargin(), entity.color,
+				lod == LOD_IMPOSTOR ? BOX_MESH_CARD : BOX_MESH_FULL);
+		else
+			m_lodStats.triangles += DrawShape(transform, entity.pShape, entity.color, lod);
+	}
 
-		// if the first domino hasnt already tipped over and started the chain reaction
-		CheckForCollisionEvents();
+	// draw every queued box in one go
+	if (instanced) {
+		m_boxRenderer.Flush();
+		m_lodStats.triangles += m_boxRenderer.GetNumTriangles();
+	}
+}
 
-		if(start == 0)
-		{
-			// apply a force to the first domino, starting the chain reaction
-			dominos.at(0)->GetRigidBody()->applyCentralForce(btVector3(0, 0, 7));
-		}
+void BulletOpenGLApplication::UpdateScene(float dt) {
+	// step the simulation through time. This is called
+	// every update and the amount of elasped time was
+	// determined back in ::Idle() by our clock object.
+	// A recording being played back takes the simulation's place,
+	// and the physics thread steps the world by itself
+	if (m_physicsThread.IsRunning())
+		return;
+	if (m_player.IsOpen()) {
+		if (!m_paused)
+			m_player.Advance(dt);
+		m_player.Apply(m_pSimulation->GetEntities());
+		return;
 	}
+	if (!m_paused) {
+		// however long the frame was, the world moves in whole steps
+		int steps = m_timeStep.BeginFrame(dt);
+		btClock clock;
+		for (int i = 0; i < steps; i++) {
+			// a maxSubSteps of 0 steps the world by exactly one step
+			m_pSimulation->UpdateScene(m_timeStep.GetStepSize(), 0);
+		}
+		double stepMilliseconds = clock.getTimeMicroseconds() / 1000.0;
 
-	// if we have deleted all the dominos
-	if(reset == 1)
-	{
-		//re create them (but this doesnt work, it just breaks, cant figure out why)
-		CreateObjects();
-		reset = 0;
+		// only the adaptive mode needs to know how fast things are going
+		const TimeStepSettings &settings = m_timeStep.GetSettings();
+		m_timeStep.EndFrame(stepMilliseconds, settings.mode == TIMESTEP_ADAPTIVE ? m_pSimulation->GetMaxSafeStep() : 0.0f);
 	}
+
+	// draw what is between the last two steps, rather than jumping
+	// a whole step at a time when frames and steps don't line up
+	if (m_timeStep.GetSettings().interpolate)
+		m_pSimulation->InterpolateMotionStates((1.0f - m_timeStep.GetAlpha()) * m_timeStep.GetStepSize());
 }
 
-void BulletOpenGLApplication::DrawShape(btScalar* transform, const btCollisionShape* pShape, const btVector3 &color, GLfloat rotation) {
+int BulletOpenGLApplication::DrawShape(const btScalar* transform, const btCollisionShape* pShape, const btVector3 &color, LodLevel lod) {
+	int triangles = 0;
+
 	// set the color
 	glColor3f(color.x(), color.y(), color.z());
 
@@ -342,11 +697,8 @@ void BulletOpenGLApplication::DrawShape(btScalar* transform, const btCollisionSh
 			const btBoxShape* box = static_cast<const btBoxShape*>(pShape);
 			// get the 'halfSize' of the box
 			btVector3 halfSize = box->getHalfExtentsWithMargin();
-	
-			// rotate the dominos based on their rotation
-			glRotatef(rotation, 1.0f, 0.0f, 0.0f);
 
-			DrawBox(halfSize);
+			triangles = lod == LOD_IMPOSTOR ? DrawCard(halfSize) : DrawBox(halfSize);
 			break;
 		}
 
@@ -358,7 +710,7 @@ void BulletOpenGLApplication::DrawShape(btScalar* transform, const btCollisionSh
 			float radius = pCylinder->getRadius();
 			float halfHeight = pCylinder->getHalfExtentsWithMargin()[1];
 			// draw the cylinder
-			DrawCylinder(radius,halfHeight);
+			triangles = DrawCylinder(radius,halfHeight,lod);
 
 		break;
 		}
@@ -369,131 +721,17 @@ void BulletOpenGLApplication::DrawShape(btScalar* transform, const btCollisionSh
 
 	// pop the stack
 	glPopMatrix();
+	return triangles;
 }
 
-void BulletOpenGLApplication::CreateGameObject(btCollisionShape* pShape, const float &mass, const btVector3 &color, const btVector3 &initialPosition, const btQuaternion &initialRotation) {
-	// create a new game object
-	GameObject* pObject = new GameObject(pShape, mass, color, initialPosition, initialRotation);
-
-	// push it to the back of the list
-	m_objects.push_back(pObject);
-
-	// check if the world object is valid
-	if (m_pWorld) {
-		// add the object's rigid body to the world
-		m_pWorld->addRigidBody(pObject->GetRigidBody());
-	}
+int BulletOpenGLApplication::DrawCylinder(const btScalar &radius, const btScalar &halfHeight, LodLevel lod) {
+	// fewer slices and stacks the smaller the cylinder is on screen.
+	// A distant cylinder just keeps its coarsest mesh
+	int slices = LodSelector::GetCylinderSlices(lod);
+	int stacks = LodSelector::GetCylinderStacks(lod);
+	if (slices == 0)
+		return 0;
+	// the mesh is tessellated the first time a cylinder of this size
+	// and detail is drawn, and every draw after that reuses it
+	return m_meshCache.DrawCylinder(radius, halfHeight, slices, stacks);
 }
-
-void BulletOpenGLApplication::CreateDomino(const btVector3 &initialPosition, GLfloat rotation) {
-	// create a new game object
-	Domino* domino = new Domino(initialPosition, rotation);
-
-	// push it to the back of the list
-	dominos.push_back(domino);
-
-	//positions.push_back(initialPosition);
-
-	// check if the world object is valid
-	if (m_pWorld) {
-		// add the object's rigid body to the world
-		m_pWorld->addRigidBody(domino->GetRigidBody());
-	}
-}
-
-void BulletOpenGLApplication::CreateObjects() {
-
-	float x, z, y;
-	z = -17.0f;
-	x = 0.0f;
-	y = 0.0f;
-
-	// the initial idea was to have a cool looking domino setup, spirals, staircases ect
-	// this relies on being able to rotate the dominos so you can have them in more than just a straight line, you need to
-	// rotate them so they can curve and go in circles among other things
-	// however, we couldnt get the dominos to rotate correctly, they would rotate, but act and fall as if not rotated
-	// becuase of this we were very limited in what we could do in terms of 'domino setup' so just showed a few dominos falling over
-	GLfloat rotation = 0.0f;
-
-	// set up first 6 dominos
-	for (int i = 0; i < 6; i++)
-	{
-		CreateDomino(btVector3(x, y, z), rotation);
-		z += 1.5;
-	}
-
-	// create a blue cylinder
-	CreateGameObject(new btCylinderShape(btVector3(1,2.0,1)), 2.0, btVector3(0.0f, 0.0f, 8.0f), btVector3(x, y, z));
-
-	z += 5;
-	x = -1;
-	int x2 = 1;
-
-	// set up next 12 dominos in 2 lines
-	for (int i = 0; i < 6; i++)
-	{
-		CreateDomino(btVector3(x, y, z), rotation);
-		CreateDomino(btVector3(x2, y, z), rotation);
-		z += 1.5;
-	}
-}
-
-void BulletOpenGLApplication::CheckForCollisionEvents() {
-
-	// iterate through all of the manifolds in the dispatcher
-	for (int i = 0; i < m_pDispatcher->getNumManifolds(); ++i) {
-		
-		// get the manifold
-		btPersistentManifold* pManifold = m_pDispatcher->getManifoldByIndexInternal(i);
-		
-		// ignore manifolds that have 
-		// no contact points.
-		if (pManifold->getNumContacts() > 0) {
-			// get the two rigid bodies involved in the collision
-			const btRigidBody* pBody0 = static_cast<const btRigidBody*>(pManifold->getBody0());
-			const btRigidBody* pBody1 = static_cast<const btRigidBody*>(pManifold->getBody1());
-
-			CollisionEvent((btRigidBody*)pBody0, (btRigidBody*)pBody1);
-		}
-	}
-}
-
-void BulletOpenGLApplication::CollisionEvent(btRigidBody * pBody0, btRigidBody * pBody1) 
-{
-	// if one of the collided dominos is the first
-	if(pBody0 == dominos.at(0)->GetRigidBody() || pBody1 == dominos.at(0)->GetRigidBody())
-	{
-		//if one of the collided dominos id the second
-		if(pBody0 == dominos.at(1)->GetRigidBody() || pBody1 == dominos.at(1)->GetRigidBody())
-		{
-			// stop tipping over the first (applying the force to it)
-			start = 1;
-		}
-	}
-}
-
-void BulletOpenGLApplication::DrawCylinder(const btScalar &radius, const btScalar &halfHeight) {
-/*ADD*/		static int slices = 15;
-/*ADD*/		static int stacks = 10;
-/*ADD*/		// tweak the starting position of the
-/*ADD*/		// cylinder to match the physics object
-/*ADD*/		glRotatef(-90.0, 1.0, 0.0, 0.0);
-/*ADD*/		glTranslatef(0.0, 0.0, -halfHeight);
-/*ADD*/		// create a quadric object to render with
-/*ADD*/		GLUquadricObj *quadObj = gluNewQuadric();
-/*ADD*/		// set the draw style of the quadric
-/*ADD*/		gluQuadricDrawStyle(quadObj, (GLenum)GLU_FILL);
-/*ADD*/		gluQuadricNormals(quadObj, (GLenum)GLU_SMOOTH);
-/*ADD*/		// create a disk to cap the cylinder
-/*ADD*/		gluDisk(quadObj, 0, radius, slices, stacks);
-/*ADD*/		// create the main hull of the cylinder (no caps)
-/*ADD*/		gluCylinder(quadObj, radius, radius, 2.f*halfHeight, slices, stacks);
-/*ADD*/		// shift the position and rotation again
-/*ADD*/		glTranslatef(0.0f, 0.0f, 2.f*halfHeight);
-/*ADD*/		glRotatef(-180.0f, 0.0f, 1.0f, 0.0f);
-/*ADD*/		// draw the cap on the other end of the cylinder
-/*ADD*/		gluDisk(quadObj, 0, radius, slices, stacks);
-/*ADD*/		// don't need the quadric anymore, so remove it
-/*ADD*/		// to save memory
-/*ADD*/		gluDeleteQuadric(quadObj);
-/*ADD*/	}
\ No newline at end of file
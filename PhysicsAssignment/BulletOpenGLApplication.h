@@ -10,14 +10,31 @@
 // include our custom Motion State object
 #include "OpenGLMotionState.h"
 
-#include "GameObject.h"
-#include "Domino.h"
-#include <vector>
+// the world and everything in it lives in the simulation
+#include "PhysicsSimulation.h"
+#include "SceneSimulation.h"
 
-// a convenient typedef to reference an STL vector of GameObjects
-typedef std::vector<GameObject*> GameObjects;
+// draws all the boxes in one instanced call
+#include "InstancedRenderer.h"
 
-typedef std::vector<Domino*> Dominos;
+// keeps tessellated meshes around between frames
+#include "MeshCache.h"
+
+// skips the bodies the camera can't see
+#include "FrustumCuller.h"
+
+// draws distant shapes with fewer triangles
+#include "LevelOfDetail.h"
+
+// steps the world on its own thread while we draw
+#include "PhysicsThread.h"
+
+// or in fixed steps from the frame loop
+#include "TimeStepController.h"
+
+// rendering without a window, and saving the frames
+#include "OffscreenContext.h"
+#include "FrameCapture.h"
 
 
 // struct to store our raycasting results
@@ -30,10 +47,60 @@ class BulletOpenGLApplication {
 public:
 	BulletOpenGLApplication();
 	~BulletOpenGLApplication();
+
+	// use a scene file instead of the hand-placed demo scene. Must be
+	// called before Initialize(). Returns false if the file can't be read
+	bool LoadScene(const char* path);
+
+	// record every simulation step to a file, starting once Initialize()
+	// has built the scene
+	void RecordTo(const char* path) { m_recordPath = path; }
+
+	// play a recording back instead of simulating. The recording must
+	// have been made of the same scene. Must be called before Initialize()
+	bool LoadRecording(const char* path);
+
+	// step the world on its own thread, so drawing never waits for a
+	// step. Off by default, since with the world on another thread
+	// culling can't use the broadphase and falls back to testing every
+	// entity's bounding sphere. Must be set before Initialize()
+	void SetPhysicsThread(bool enabled) { m_usePhysicsThread = enabled; }
+
+	// how the world is stepped, on the physics thread or not
+	void SetTimeStep(const TimeStepSettings &settings) { m_timeStep.SetSettings(settings); }
+
+	// only simulate the dominos near the toppling front. Must be set
+	// before Initialize()
+	void SetWavefront(const WavefrontSettings &settings) { m_wavefront = settings; }
+
+	// which broadphase the world uses. Must be set before Initialize()
+	void SetBroadphase(const BroadphaseSettings &settings) { m_broadphase = settings; }
+
+	// which constraint solver the world uses and how hard it works.
+	// Must be set before Initialize()
+	void SetSolver(const SolverSettings &settings) { m_solver = settings; }
+
+	// continuous collision for thin boxes. Must be set before Initialize()
+	void SetCcd(const CcdSettings &settings) { m_ccd = settings; }
+
 	void Initialize();
+
+	// render frames frames of width x height without a window, using a
+	// software OpenGL context, and save each as <prefix>NNNNN.tga. The
+	// scene is stepped by a fixed 1/60th of a second per frame. Replaces
+	// glutmain(). Returns false if the context can't be created
+	bool RunOffscreen(const char* prefix, int width, int height, int frames);
+
 	// FreeGLUT callbacks //
 	virtual void Keyboard(unsigned char key, int x, int y);
 	virtual void Idle();
+	virtual void Reshape(int width, int height);
+
+	// update and draw one frame into the current buffer
+	void RenderFrame(float dt);
+
+	// the last second's average phase times, drawn over the scene
+	void DrawProfileOverlay();
 
 	// rendering. Can be overrideen by derived classes
 	virtual void RenderScene();
@@ -44,25 +111,18 @@ public:
 	// camera functions
 	void UpdateCamera();
 
-	// drawing functions
-	void DrawBox(const btVector3 &halfSize);
-	void DrawShape(btScalar* transform, const btCollisionShape* pShape, const btVector3 &color, GLfloat rotation);
+	// how many entities the last frame drew and skipped
+	const CullStats& GetCullStats() const { return m_culler.GetStats(); }
 
-	void CreateGameObject(btCollisionShape* pShape, 
-			const float &mass, 
-			const btVector3 &color = btVector3(1.0f,1.0f,1.0f), 
-			const btVector3 &initialPosition = btVector3(0.0f,0.0f,0.0f), 
-			const btQuaternion &initialRotation = btQuaternion(0,0,1,1));
+	// how much detail the last frame drew things with
+	const LodStats& GetLodStats() const { return m_lodStats; }
 
-	void CreateDomino(const btVector3 &initialPosition, GLfloat rotation);
+	// drawing functions. Each returns the number of triangles it drew
+	int DrawBox(const btVector3 &halfSize);
+	int DrawCard(const btVector3 &halfSize);
+	int DrawShape(const btScalar* transform, const btCollisionShape* pShape, const btVector3 &color, LodLevel lod = LOD_FULL);
 
-    void DrawCylinder(const btScalar &radius, const btScalar &halfHeight);
-
-	void CreateObjects();
-
-	void CheckForCollisionEvents();
-
-	void CollisionEvent(btRigidBody * pBody0, btRigidBody * pBody1);
+    int DrawCylinder(const btScalar &radius, const btScalar &halfHeight, LodLevel lod = LOD_FULL);
 
 protected:
 	// camera control
@@ -78,22 +138,56 @@ protected:
 	int m_screenWidth;
 	int m_screenHeight;
 
-	int reset;
-	int start;
+	// the physics world, its bodies and the domino game logic
+	PhysicsSimulation* m_pSimulation;
 
-	// core Bullet components
-	btBroadphaseInterface* m_pBroadphase;
-	btCollisionConfiguration* m_pCollisionConfiguration;
-	btCollisionDispatcher* m_pDispatcher;
-	btConstraintSolver* m_pSolver;
-	btDynamicsWorld* m_pWorld;
+	// the scene file the simulation is built from, if any
+	SceneFile m_scene;
 
 	// a simple clock for counting time
 	btClock m_clock;
 
-	// an array of our game objects
-	GameObjects m_objects;
+	// batches every box into a single draw call, when the driver allows it
+	InstancedRenderer m_boxRenderer;
+
+	// cylinder meshes, built once per size and reused every frame
+	MeshCache m_meshCache;
+
+	// what the camera can see, rebuilt by UpdateCamera()
+	ViewFrustum m_frustum;
+	FrustumCuller m_culler;
+	bool m_culling;
+
+	// the entities that passed culling this frame and the matrices to
+	// draw them with, kept between frames so the vectors don't reallocate
+	std::vector<const Entity*> m_visible;
+	std::vector<const btScalar*> m_visibleMatrices;
+
+	// steps the world when it isn't stepped from Idle()
+	PhysicsThread m_physicsThread;
+	bool m_usePhysicsThread;
+
+	// turns the time between frames into fixed steps otherwise. The
+	// physics thread keeps its own, started from this one's settings
+	TimeStepController m_timeStep;
+
+	WavefrontSettings m_wavefront;
+	BroadphaseSettings m_broadphase;
+	SolverSettings m_solver;
+	CcdSettings m_ccd;
+
+	// whether the profiler's overlay is showing
+	bool m_showProfile;
+
+	// where the recording goes, if recording, and the recording being
+	// played back, if playing. Playing back never steps the world
+	const char* m_recordPath;
+	TrajectoryRecorder m_recorder;
+	TrajectoryPlayer m_player;
+	bool m_paused;
 
-	Dominos dominos;
+	// picks how finely each shape is drawn from its size on screen
+	LodSelector m_lod;
+	LodStats m_lodStats;
 };
 #endif
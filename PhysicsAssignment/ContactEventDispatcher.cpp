@@ -0,0 +1,101 @@
+#include "ContactEventDispatcher.h"
+
+// a manifold's m_companionIdB is set to this while it is watched, and its
+// m_companionIdA to its position in m_tracked. Bullet zeroes both when it
+// makes a manifold. The mark is only changed by the thread making or
+// releasing the manifold, or between steps, so it can be checked
+// without the lock
+#define TRACKED_MARK 1
+
+ContactEventDispatcher::ContactEventDispatcher(btCollisionConfiguration* pConfiguration)
+:
+ContactEventDispatcherBase(pConfiguration)
+{
+}
+
+btPersistentManifold* ContactEventDispatcher::getNewManifold(const btCollisionObject* pBody0, const btCollisionObject* pBody1) {
+	btPersistentManifold* pManifold = ContactEventDispatcherBase::getNewManifold(pBody0, pBody1);
+
+	// only watch pairs somebody cares about
+	if (IsSubscribed(pBody0) || IsSubscribed(pBody1)) {
+		TrackedManifold tracked;
+		tracked.pManifold = pManifold;
+		tracked.touching = false;
+		pManifold->m_companionIdB = TRACKED_MARK;
+#ifdef BT_THREADSAFE
+		m_mutex.lock();
+#endif
+		pManifold->m_companionIdA = (int)m_tracked.size();
+		m_tracked.push_back(tracked);
+#ifdef BT_THREADSAFE
+		m_mutex.unlock();
+#endif
+	}
+	return pManifold;
+}
+
+void ContactEventDispatcher::releaseManifold(btPersistentManifold* pManifold) {
+	// watched manifolds are dropped whether or not their bodies are
+	// still subscribed, since either may have unsubscribed since
+	if (pManifold->m_companionIdB == TRACKED_MARK) {
+#ifdef BT_THREADSAFE
+		m_mutex.lock();
+#endif
+		int i = pManifold->m_companionIdA;
+		btAssert(m_tracked[i].pManifold == pManifold);
+
+		// the pair has gone, so a contact that was still
+		// touching ends here
+		if (m_tracked[i].touching)
+			QueueEvent(CONTACT_END, pManifold);
+		Untrack(i);
+#ifdef BT_THREADSAFE
+		m_mutex.unlock();
+#endif
+	}
+
+	ContactEventDispatcherBase::releaseManifold(pManifold);
+}
+
+void ContactEventDispatcher::ProcessContacts() {
+	for (int i = 0; i < m_tracked.size(); ) {
+		TrackedManifold &tracked = m_tracked[i];
+		const btPersistentManifold* pManifold = tracked.pManifold;
+
+		// both bodies have unsubscribed since the manifold was made.
+		// Released manifolds never get this far, so it is still alive
+		if (!IsSubscribed(pManifold->getBody0()) && !IsSubscribed(pManifold->getBody1())) {
+			Untrack(i);
+			continue;
+		}
+
+		bool touching = pManifold->getNumContacts() > 0;
+		if (touching)
+			QueueEvent(tracked.touching ? CONTACT_PERSIST : CONTACT_BEGIN, pManifold);
+		else if (tracked.touching)
+			QueueEvent(CONTACT_END, pManifold);
+
+		tracked.touching = touching;
+		i++;
+	}
+}
+
+void ContactEventDispatcher::Untrack(int i) {
+	m_tracked[i].pManifold->m_companionIdA = 0;
+	m_tracked[i].pManifold->m_companionIdB = 0;
+
+	if (i != (int)m_tracked.size() - 1) {
+		m_tracked[i] = m_tracked.back();
+		m_tracked[i].pManifold->m_companionIdA = i;
+	}
+	m_tracked.pop_back();
+}
+
+void ContactEventDispatcher::QueueEvent(ContactEventType type, const btPersistentManifold* pManifold) {
+	ContactEvent event;
+	event.type = type;
+	event.pBody0 = pManifold->getBody0();
+	event.pBody1 = pManifold->getBody1();
+	event.numContacts = pManifold->getNumContacts();
+	m_events.push_back(event);
+}
@@ -0,0 +1,110 @@
+#ifndef _CONTACTEVENTDISPATCHER_H_
+#define _CONTACTEVENTDISPATCHER_H_
+
+#include "btBulletDynamicsCommon.h"
+
+#ifdef BT_THREADSAFE
+#include "BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h"
+#include "LinearMath/btThreads.h"
+#endif
+
+#include <vector>
+
+// what happened between two bodies during a step
+enum ContactEventType {
+	CONTACT_BEGIN,		// the bodies started touching
+	CONTACT_PERSIST,	// the bodies are still touching
+	CONTACT_END			// the bodies stopped touching, or one was removed
+};
+
+// one contact event. An end event raised by removing a body from the
+// world may name a body that has since been destroyed, so the bodies
+// should only be compared against, never dereferenced
+struct ContactEvent {
+	ContactEventType type;
+	const btCollisionObject* pBody0;
+	const btCollisionObject* pBody1;
+	int numContacts;
+};
+
+// a thread safe Bullet build gets the parallel dispatcher, which hands
+// the narrowphase out to the task scheduler. It behaves exactly like the
+// plain one when there is only one thread
+#ifdef BT_THREADSAFE
+typedef btCollisionDispatcherMt ContactEventDispatcherBase;
+#else
+typedef btCollisionDispatcher ContactEventDispatcherBase;
+#endif
+
+// a collision dispatcher that reports contacts for the bodies that ask
+// for them. Rather than scanning every manifold each step, it watches
+// manifolds being created and released and only keeps track of the
+// ones touching a subscribed body. A watched manifold is marked as such
+// and remembers where it is in the watch list, in two companion ids that
+// Bullet's own dispatcher leaves unused, so it is always found and
+// dropped when it is released, whatever has been subscribed or
+// unsubscribed in the meantime. ProcessContacts() turns those into
+// begin/persist/end events, which are queued until the game drains them,
+// so the cost per step grows with the subscribed contacts rather than
+// with every contact in the world
+class ContactEventDispatcher : public ContactEventDispatcherBase {
+public:
+	ContactEventDispatcher(btCollisionConfiguration* pConfiguration);
+
+	// a body's subscription is kept in its user index, so it is checked
+	// without a lookup every time Bullet makes a manifold. Bullet starts
+	// every body's user index at -1, which reads as unsubscribed
+	static void Subscribe(btCollisionObject* pBody) { pBody->setUserIndex(SUBSCRIBED); }
+	static void Unsubscribe(btCollisionObject* pBody) { pBody->setUserIndex(-1); }
+	static bool IsSubscribed(const btCollisionObject* pBody) { return pBody->getUserIndex() == SUBSCRIBED; }
+
+	// manifold tracking
+	virtual btPersistentManifold* getNewManifold(const btCollisionObject* pBody0, const btCollisionObject* pBody1);
+	virtual void releaseManifold(btPersistentManifold* pManifold);
+
+	// compare the tracked manifolds against the last step and queue
+	// the events. Called once per internal simulation step
+	void ProcessContacts();
+
+	// the queued events, oldest first
+	int GetNumEvents() const { return (int)m_events.size(); }
+	const ContactEvent& GetEvent(int i) const { return m_events[i]; }
+	void ClearEvents() { m_events.clear(); }
+
+	// how many manifolds are being watched
+	int GetNumTrackedManifolds() const { return (int)m_tracked.size(); }
+
+	// make room in the dispatcher's list of manifolds for count of them,
+	// and in the tracked list and event queue to match, so none of them
+	// reallocate as contacts are made
+	void ReserveManifolds(int count) {
+		m_manifoldsPtr.reserve(count);
+		m_tracked.reserve(count);
+		m_events.reserve(count);
+	}
+
+private:
+	enum {
+		SUBSCRIBED = 1
+	};
+
+	struct TrackedManifold {
+		btPersistentManifold* pManifold;
+		bool touching;
+	};
+
+	void QueueEvent(ContactEventType type, const btPersistentManifold* pManifold);
+
+	// stop watching m_tracked[i], moving the last one into its place
+	void Untrack(int i);
+
+#ifdef BT_THREADSAFE
+	// manifolds can be made and released by the worker threads
+	btSpinMutex m_mutex;
+#endif
+
+	std::vector<TrackedManifold> m_tracked;
+	std::vector<ContactEvent> m_events;
+};
+
+#endif
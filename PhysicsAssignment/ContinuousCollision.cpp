@@ -0,0 +1,22 @@
+#include "ContinuousCollision.h"
+
+bool SetupContinuousCollision(btRigidBody* pBody, const CcdSettings &settings) {
+	if (!settings.enabled || pBody->isStaticOrKinematicObject())
+		return false;
+
+	const btCollisionShape* pShape = pBody->getCollisionShape();
+	if (pShape->getShapeType() != BOX_SHAPE_PROXYTYPE)
+		return false;
+
+	btVector3 halfExtents = static_cast<const btBoxShape*>(pShape)->getHalfExtentsWithMargin();
+	btScalar thinnest = halfExtents[halfExtents.minAxis()];
+	btScalar longest = halfExtents[halfExtents.maxAxis()];
+	if (thinnest > longest * settings.thinRatio)
+		return false;
+
+	// moving less than its half thickness in a step, the box can't get
+	// past anything without the discrete contacts catching it
+	pBody->setCcdMotionThreshold(thinnest);
+	pBody->setCcdSweptSphereRadius(thinnest * settings.sphereFraction);
+	return true;
+}
@@ -0,0 +1,27 @@
+#ifndef _CONTINUOUSCOLLISION_H_
+#define _CONTINUOUSCOLLISION_H_
+
+#include "btBulletDynamicsCommon.h"
+
+struct CcdSettings {
+	bool enabled;
+	// a box counts as thin, and gets continuous collision, when its
+	// thinnest side is at most this fraction of its longest
+	btScalar thinRatio;
+	// the swept sphere's radius as a fraction of the box's half
+	// thickness. Under 1 keeps the sphere inside the box, so a sweep
+	// never stops the box short of something it isn't touching
+	btScalar sphereFraction;
+
+	// a domino is a tenth as thick as it is tall
+	CcdSettings() : enabled(true), thinRatio(0.25f), sphereFraction(0.9f) {}
+};
+
+// turn on continuous collision for pBody if it is a dynamic, thin box.
+// Whenever a step would move it further than its half thickness, Bullet
+// sweeps a sphere along its path first and stops it at the first thing
+// in the way, so it can't step clean through another body. The sweep
+// only follows the body's centre, not its spin. Returns whether it did
+bool SetupContinuousCollision(btRigidBody* pBody, const CcdSettings &settings);
+
+#endif
@@ -0,0 +1,33 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+// replaces the global new and delete so that every allocation the
+// application makes, and any Bullet makes with plain new, is counted.
+// Linked into the benchmark only
+
+void* operator new(size_t size) {
+	g_allocations.Add(size);
+	void* pMemory = malloc(size ? size : 1);
+	if (!pMemory)
+		throw std::bad_alloc();
+	return pMemory;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* pMemory) throw() {
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory) throw() {
+	free(pMemory);
+}
+
+// tell the counter it is seeing everything
+static struct CountingNewMarker {
+	CountingNewMarker() { g_allocations.SetCountingNew(); }
+} s_countingNewMarker;
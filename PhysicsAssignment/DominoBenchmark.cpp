@@ -0,0 +1,761 @@
+#include "AllocationCounter.h"
+#include "LayoutSimulation.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// builds generated domino chains of increasing size, steps each one
+// headless at a fixed dt and writes the timings out as JSON so runs
+// from different builds can be compared. Each scene can be run at
+// several thread counts to see how stepping scales with cores, and with
+// several solver profiles to see what each one's speed costs in how the
+// chain topples.
+//
+// given --step-sweep, it instead runs small chains to completion at each
+// of a list of fixed steps, with and without continuous collision, to
+// find the largest step each can take before dominos pass through one
+// another, and how much faster the chain gets simulated at that step
+
+// peak resident set size of the whole process in kilobytes
+static long GetPeakRSSKilobytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return (long)(counters.PeakWorkingSetSize / 1024);
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return usage.ru_maxrss;
+	return 0;
+#endif
+}
+
+// nearest-rank percentile of an already sorted sample
+static double Percentile(const std::vector<double> &sorted, double p) {
+	if (sorted.empty())
+		return 0.0;
+	size_t rank = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+	return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+// splits "a,b,c" into its parts
+static std::vector<std::string> SplitList(const char* list) {
+	std::vector<std::string> parts;
+	std::string current;
+	for (const char* c = list; *c; c++) {
+		if (*c == ',') {
+			if (!current.empty())
+				parts.push_back(current);
+			current.clear();
+		} else {
+			current += *c;
+		}
+	}
+	if (!current.empty())
+		parts.push_back(current);
+	return parts;
+}
+
+struct BenchmarkOptions {
+	std::vector<std::string> layouts;
+	std::vector<int> sizes;
+	std::vector<int> threads;
+	std::vector<BroadphaseType> broadphases;
+	std::vector<SolverProfile> solvers;
+	int steps;
+	float dt;
+	int sampleEvery;
+	const char* outputPath;
+	bool wavefront;
+	int steadyAfter;		// steps before the simulation counts as settled in
+	bool assertNoAllocations;
+	bool ccd;
+
+	// the fixed steps to try in a step sweep, none for the usual benchmark,
+	// how many dominos each swept chain has, and how many simulated
+	// seconds it gets to fall in
+	std::vector<float> sweepSteps;
+	int sweepCount;
+	float sweepMaxTime;
+
+	BenchmarkOptions() : steps(300), dt(1.0f / 60.0f), sampleEvery(10), outputPath(0), wavefront(false), steadyAfter(60), assertNoAllocations(false), ccd(true),
+		sweepCount(100), sweepMaxTime(120.0f) {
+		layouts.push_back("line");
+		layouts.push_back("double");
+		layouts.push_back("grid");
+		sizes.push_back(1000);
+		sizes.push_back(10000);
+		sizes.push_back(100000);
+		sizes.push_back(1000000);
+		threads.push_back(1);
+		broadphases.push_back(BROADPHASE_DBVT);
+		solvers.push_back(SOLVER_PROFILE_BALANCED);
+	}
+};
+
+struct BenchmarkResult {
+	std::string layout;
+	int dominos;
+	int threads;
+	BroadphaseType broadphase;
+	SolverProfile solver;
+	double setupMs;
+	int steps;
+
+	// per-step wall time in milliseconds
+	double stepMean, stepP50, stepP90, stepP99, stepMax;
+
+	// mean step time on one thread over mean step time on this many,
+	// or 0 if the single threaded run wasn't part of this benchmark
+	double speedup;
+
+	// mean step time with the default broadphase over mean step time with
+	// this one, on the same scene and threads, or 0 if the default wasn't run
+	double broadphaseSpeedup;
+
+	// the pair cache's room before the first step, the most pairs it
+	// held, and whether it still had to grow
+	int pairsReserved;
+	int pairsMax;
+	bool pairCacheGrew;
+
+	// how many dominos fell, whether that was all of them, and after how
+	// many simulated seconds the first and the last of them did, or -1
+	// if none did
+	int toppled;
+	bool completed;
+	float firstTopple;
+	float completionTime;
+	std::vector<float> toppleTimes;		// a ToppleTracker's
+
+	// how far the toppling strayed from the accurate profile's, on the
+	// same scene, threads and broadphase: the difference in completion
+	// time, that as a fraction of the accurate one, the difference in
+	// dominos fallen, and the accurate profile's mean step time over
+	// this one's. Only set if the accurate profile was run, and the
+	// completion times only if both chains fell all the way within the
+	// steps run, since otherwise they are just where each got cut off.
+	//
+	// a big chain never finishes in a benchmark's few seconds, so the
+	// front is also compared over the dominos both runs toppled: how
+	// many that was, the difference in the time each took to topple
+	// them, that as a fraction of the accurate one, and each run's front
+	// speed over them in dominos per simulated second
+	bool hasReference;
+	int sharedToppled;
+	float sharedTimeError;
+	float sharedTimeErrorRatio;
+	float frontSpeed;
+	float referenceFrontSpeed;
+	bool hasCompletionError;
+	float completionError;
+	float completionErrorRatio;
+	int toppledError;
+	double solverSpeedup;
+
+	// heap allocations while building the scene, during the first
+	// steadyAfter steps, and after them, with how many of those later
+	// steps allocated at all
+	unsigned long long setupAllocations;
+	unsigned long long warmupAllocations;
+	unsigned long long steadyAllocations;
+	unsigned long long steadyBytes;
+	int steadyStepsAllocating;
+
+	// manifold counts, sampled every few steps
+	double manifoldMean;
+	int manifoldMax;
+	int manifoldFinal;
+
+	int activeMax;
+	int activeFinal;
+	int sleepingFinal;
+	int frozenFinal;		// dominos the wavefront has frozen, ahead of and behind the fronts
+	long peakRSSKilobytes;
+
+	ShapeRegistryStats shapes;
+};
+
+static BenchmarkResult RunBenchmark(const std::string &layoutName, int size, int threads, BroadphaseType broadphase, SolverProfile solver, const BenchmarkOptions &options) {
+	BenchmarkResult result;
+	result.layout = layoutName;
+	result.dominos = size;
+	result.broadphase = broadphase;
+	result.solver = solver;
+	result.steps = options.steps;
+	result.speedup = 0.0;
+	result.broadphaseSpeedup = 0.0;
+	result.toppled = 0;
+	result.completed = false;
+	result.firstTopple = -1.0f;
+	result.completionTime = -1.0f;
+	result.hasReference = false;
+	result.sharedToppled = 0;
+	result.sharedTimeError = 0.0f;
+	result.sharedTimeErrorRatio = 0.0f;
+	result.frontSpeed = 0.0f;
+	result.referenceFrontSpeed = 0.0f;
+	result.hasCompletionError = false;
+	result.completionError = 0.0f;
+	result.completionErrorRatio = 0.0f;
+	result.toppledError = 0;
+	result.solverSpeedup = 0.0;
+
+	DominoLayout layout;
+	BuildLayoutByName(layoutName, size, DOMINO_DEFAULT_SPACING, layout);
+
+	btClock clock;
+	AllocationCounts setupStart = g_allocations.GetCounts();
+	LayoutSimulation simulation(layout);
+	simulation.SetNumThreads(threads);
+	WavefrontSettings wavefront;
+	wavefront.enabled = options.wavefront;
+	simulation.SetWavefront(wavefront);
+	BroadphaseSettings broadphaseSettings;
+	broadphaseSettings.type = broadphase;
+	simulation.SetBroadphase(broadphaseSettings);
+	simulation.SetSolver(GetSolverProfile(solver));
+	CcdSettings ccd;
+	ccd.enabled = options.ccd;
+	simulation.SetCcd(ccd);
+	simulation.Initialize();
+	result.threads = simulation.GetNumThreads();
+	result.pairsReserved = simulation.GetPairCache()->getOverlappingPairArray().capacity();
+	result.pairsMax = 0;
+	result.setupAllocations = g_allocations.GetCounts().allocations - setupStart.allocations;
+	result.warmupAllocations = 0;
+	result.steadyAllocations = 0;
+	result.steadyBytes = 0;
+	result.steadyStepsAllocating = 0;
+	result.setupMs = clock.getTimeMicroseconds() / 1000.0;
+
+	std::vector<double> stepTimes;
+	stepTimes.reserve(options.steps);
+
+	double manifoldTotal = 0.0;
+	int manifoldSamples = 0;
+	result.manifoldMax = 0;
+	result.activeMax = 0;
+
+	ToppleTracker topple(&simulation);
+
+	for (int i = 0; i < options.steps; i++) {
+		AllocationCounts before = g_allocations.GetCounts();
+		clock.reset();
+		simulation.UpdateScene(options.dt, 0);
+		stepTimes.push_back(clock.getTimeMicroseconds() / 1000.0);
+
+		AllocationCounts after = g_allocations.GetCounts();
+		unsigned long long allocations = after.allocations - before.allocations;
+		if (i < options.steadyAfter) {
+			result.warmupAllocations += allocations;
+		} else if (allocations > 0) {
+			result.steadyAllocations += allocations;
+			result.steadyBytes += after.bytes - before.bytes;
+			result.steadyStepsAllocating++;
+		}
+
+		// outside the timing
+		topple.Update((i + 1) * options.dt);
+
+		// counting bodies walks the whole world, so only do it now and then
+		if (i % options.sampleEvery == 0 || i == options.steps - 1) {
+			int manifolds = simulation.GetDispatcher()->getNumManifolds();
+			manifoldTotal += manifolds;
+			manifoldSamples++;
+			result.manifoldMax = std::max(result.manifoldMax, manifolds);
+			result.activeMax = std::max(result.activeMax, simulation.GetNumActiveBodies());
+			result.pairsMax = std::max(result.pairsMax, simulation.GetPairCache()->getNumOverlappingPairs());
+		}
+	}
+
+	double total = 0.0;
+	for (int i = 0; i < stepTimes.size(); i++)
+		total += stepTimes[i];
+	std::sort(stepTimes.begin(), stepTimes.end());
+
+	result.stepMean = stepTimes.empty() ? 0.0 : total / stepTimes.size();
+	result.stepP50 = Percentile(stepTimes, 50.0);
+	result.stepP90 = Percentile(stepTimes, 90.0);
+	result.stepP99 = Percentile(stepTimes, 99.0);
+	result.stepMax = stepTimes.empty() ? 0.0 : stepTimes.back();
+
+	result.toppled = topple.GetNumToppled();
+	result.completed = topple.GetNumDominos() > 0 && topple.IsComplete();
+	result.firstTopple = topple.GetFirstTopple();
+	result.completionTime = topple.GetCompletionTime();
+	result.toppleTimes = topple.GetToppleTimes();
+	result.manifoldMean = manifoldSamples ? manifoldTotal / manifoldSamples : 0.0;
+	result.manifoldFinal = simulation.GetDispatcher()->getNumManifolds();
+	result.pairCacheGrew = simulation.GetPairCache()->getOverlappingPairArray().capacity() > result.pairsReserved;
+	result.activeFinal = simulation.GetNumActiveBodies();
+	result.sleepingFinal = simulation.GetNumSleepingBodies();
+	const WavefrontStats &frozen = simulation.GetWavefront().GetStats();
+	result.frozenFinal = frozen.dormant + frozen.retired;
+	result.peakRSSKilobytes = GetPeakRSSKilobytes();
+	result.shapes = simulation.GetShapes().GetStats();
+	return result;
+}
+
+// compare every result against the accurate profile's run of the same
+// scene, threads and broadphase, if there was one
+static void CompareWithReference(std::vector<BenchmarkResult> &results) {
+	for (int i = 0; i < results.size(); i++) {
+		BenchmarkResult &r = results[i];
+		for (int j = 0; j < results.size(); j++) {
+			const BenchmarkResult &reference = results[j];
+			if (reference.solver != SOLVER_PROFILE_ACCURATE || reference.layout != r.layout || reference.dominos != r.dominos ||
+				reference.threads != r.threads || reference.broadphase != r.broadphase)
+				continue;
+
+			r.hasReference = true;
+			r.toppledError = r.toppled - reference.toppled;
+			if (r.stepMean > 0.0)
+				r.solverSpeedup = reference.stepMean / r.stepMean;
+
+			// however far both got, when each had toppled that many
+			r.sharedToppled = std::min(r.toppled, reference.toppled);
+			if (r.sharedToppled > 0) {
+				float time = r.toppleTimes[r.sharedToppled - 1];
+				float referenceTime = reference.toppleTimes[r.sharedToppled - 1];
+				r.sharedTimeError = time - referenceTime;
+				if (referenceTime > 0.0f) {
+					r.sharedTimeErrorRatio = btFabs(r.sharedTimeError) / referenceTime;
+					r.referenceFrontSpeed = r.sharedToppled / referenceTime;
+				}
+				if (time > 0.0f)
+					r.frontSpeed = r.sharedToppled / time;
+			}
+			if (r.completed && reference.completed) {
+				r.hasCompletionError = true;
+				r.completionError = r.completionTime - reference.completionTime;
+				if (reference.completionTime > 0.0f)
+					r.completionErrorRatio = btFabs(r.completionError) / reference.completionTime;
+			}
+			break;
+		}
+	}
+}
+
+static void WriteJSON(FILE* out, const BenchmarkOptions &options, const std::vector<BenchmarkResult> &results) {
+	fprintf(out, "{\n");
+	fprintf(out, "  \"benchmark\": \"domino_chain\",\n");
+	fprintf(out, "  \"dt\": %g,\n", options.dt);
+	fprintf(out, "  \"steps\": %d,\n", options.steps);
+	fprintf(out, "  \"wavefront\": %s,\n", options.wavefront ? "true" : "false");
+	fprintf(out, "  \"ccd\": %s,\n", options.ccd ? "true" : "false");
+	fprintf(out, "  \"steady_after\": %d,\n", options.steadyAfter);
+	fprintf(out, "  \"counting_new\": %s,\n", g_allocations.IsCountingNew() ? "true" : "false");
+	fprintf(out, "  \"results\": [\n");
+	for (int i = 0; i < results.size(); i++) {
+		const BenchmarkResult &r = results[i];
+		fprintf(out, "    {\n");
+		fprintf(out, "      \"layout\": \"%s\",\n", r.layout.c_str());
+		fprintf(out, "      \"dominos\": %d,\n", r.dominos);
+		fprintf(out, "      \"threads\": %d,\n", r.threads);
+		fprintf(out, "      \"broadphase\": \"%s\",\n", GetBroadphaseName(r.broadphase));
+		fprintf(out, "      \"solver\": \"%s\",\n", GetSolverProfileName(r.solver));
+		fprintf(out, "      \"setup_ms\": %.3f,\n", r.setupMs);
+		fprintf(out, "      \"steps\": %d,\n", r.steps);
+		fprintf(out, "      \"step_ms\": { \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+			r.stepMean, r.stepP50, r.stepP90, r.stepP99, r.stepMax);
+		fprintf(out, "      \"speedup\": %.3f,\n", r.speedup);
+		fprintf(out, "      \"broadphase_speedup\": %.3f,\n", r.broadphaseSpeedup);
+		fprintf(out, "      \"pair_cache\": { \"reserved\": %d, \"max\": %d, \"grew\": %s },\n",
+			r.pairsReserved, r.pairsMax, r.pairCacheGrew ? "true" : "false");
+		fprintf(out, "      \"allocations\": { \"setup\": %llu, \"warmup\": %llu, \"steady\": %llu, \"steady_bytes\": %llu, \"steady_steps_allocating\": %d },\n",
+			r.setupAllocations, r.warmupAllocations, r.steadyAllocations, r.steadyBytes, r.steadyStepsAllocating);
+		fprintf(out, "      \"topple\": { \"toppled\": %d, \"completed\": %s, \"first\": %.4f, \"completion\": %.4f },\n",
+			r.toppled, r.completed ? "true" : "false", r.firstTopple, r.completionTime);
+		if (r.hasReference) {
+			fprintf(out, "      \"fidelity\": { \"shared_toppled\": %d, \"shared_time_error\": %.4f, \"shared_time_error_ratio\": %.4f, \"front_speed\": %.2f, \"reference_front_speed\": %.2f, ",
+				r.sharedToppled, r.sharedTimeError, r.sharedTimeErrorRatio, r.frontSpeed, r.referenceFrontSpeed);
+			if (r.hasCompletionError)
+				fprintf(out, "\"completion_error\": %.4f, \"completion_error_ratio\": %.4f, ", r.completionError, r.completionErrorRatio);
+			else
+				fprintf(out, "\"completion_error\": null, \"completion_error_ratio\": null, ");
+			fprintf(out, "\"toppled_error\": %d, \"speedup\": %.3f },\n", r.toppledError, r.solverSpeedup);
+		} else
+			fprintf(out, "      \"fidelity\": null,\n");
+		fprintf(out, "      \"manifolds\": { \"mean\": %.1f, \"max\": %d, \"final\": %d },\n",
+			r.manifoldMean, r.manifoldMax, r.manifoldFinal);
+		fprintf(out, "      \"bodies\": { \"active_max\": %d, \"active_final\": %d, \"sleeping_final\": %d, \"frozen_final\": %d },\n",
+			r.activeMax, r.activeFinal, r.sleepingFinal, r.frozenFinal);
+		fprintf(out, "      \"shapes\": { \"unique\": %d, \"references\": %d, \"bytes_used\": %lu, \"bytes_saved\": %lu },\n",
+			r.shapes.uniqueShapes, r.shapes.references, (unsigned long)r.shapes.bytesUsed, (unsigned long)r.shapes.bytesSaved);
+		fprintf(out, "      \"peak_rss_kb\": %ld\n", r.peakRSSKilobytes);
+		fprintf(out, "    }%s\n", i + 1 < results.size() ? "," : "");
+	}
+	fprintf(out, "  ]\n");
+	fprintf(out, "}\n");
+}
+
+// one chain run to the end at one fixed step
+struct StepTrial {
+	float dt;
+	bool stable;			// every domino fell and none ended up in the ground
+	int toppled;
+	int sunk;				// dominos whose centre came to rest below the ground's top
+	float completionTime;	// simulated seconds until the last domino fell, or -1
+	int steps;
+	double wallMs;			// time spent stepping
+	double throughput;		// simulated seconds per wall clock second
+};
+
+// every step tried on one chain, with or without continuous collision
+struct StepSweepResult {
+	std::string layout;
+	int dominos;
+	bool ccd;
+	int ccdBodies;
+	std::vector<StepTrial> trials;
+
+	// the largest step that was stable along with every smaller step
+	// tried, or 0 if the smallest wasn't, and the throughput at it.
+	// Trials stop at the first unstable step, so trials only goes one
+	// step past it
+	float maxStableStep;
+	double throughput;
+
+	// that throughput over the throughput without continuous collision
+	// at its own largest stable step, or 0 if there is nothing to compare
+	double throughputGain;
+};
+
+static StepTrial RunStepTrial(const DominoLayout &layout, float dt, bool ccd, const BenchmarkOptions &options, int &ccdBodies) {
+	StepTrial trial;
+	trial.dt = dt;
+	trial.toppled = 0;
+	trial.sunk = 0;
+	trial.completionTime = -1.0f;
+	trial.steps = 0;
+	trial.wallMs = 0.0;
+
+	LayoutSimulation simulation(layout);
+	WavefrontSettings wavefront;
+	wavefront.enabled = options.wavefront;
+	simulation.SetWavefront(wavefront);
+	CcdSettings ccdSettings;
+	ccdSettings.enabled = ccd;
+	simulation.SetCcd(ccdSettings);
+	simulation.Initialize();
+	ccdBodies = simulation.GetNumCcdBodies();
+
+	ToppleTracker topple(&simulation);
+
+	btClock clock;
+	int maxSteps = (int)(options.sweepMaxTime / dt + 0.5f);
+	while (trial.steps < maxSteps && !topple.IsComplete()) {
+		clock.reset();
+		simulation.UpdateScene(dt, 0);
+		trial.wallMs += clock.getTimeMicroseconds() / 1000.0;
+		trial.steps++;
+		topple.Update(trial.steps * dt);
+
+		// a domino stepped through the next one leaves the rest of
+		// the chain standing, and everything goes to sleep
+		if (topple.GetNumToppled() > 0 && simulation.IsAtRest())
+			break;
+	}
+	trial.toppled = topple.GetNumToppled();
+	trial.completionTime = topple.GetCompletionTime();
+
+	// a domino can also be driven through the ground, however far
+	// along the chain got. One lying flat still has its centre half
+	// its thickness above the ground's top
+	for (int i = 0; i < topple.GetNumDominos(); i++) {
+		if (simulation.GetDominoBody(i)->getWorldTransform().getOrigin().y() < GROUND_TOP)
+			trial.sunk++;
+	}
+
+	trial.stable = topple.IsComplete() && trial.sunk == 0;
+	trial.throughput = trial.wallMs > 0.0 ? trial.steps * dt / (trial.wallMs / 1000.0) : 0.0;
+	return trial;
+}
+
+static void RunStepSweep(const BenchmarkOptions &options, std::vector<StepSweepResult> &results) {
+	for (int i = 0; i < options.layouts.size(); i++) {
+		DominoLayout layout;
+		BuildLayoutByName(options.layouts[i], options.sweepCount, DOMINO_DEFAULT_SPACING, layout);
+
+		// without continuous collision first, to compare against
+		for (int ccd = 0; ccd < 2; ccd++) {
+			StepSweepResult result;
+			result.layout = options.layouts[i];
+			result.dominos = options.sweepCount;
+			result.ccd = ccd != 0;
+			result.ccdBodies = 0;
+			result.maxStableStep = 0.0f;
+			result.throughput = 0.0;
+			result.throughputGain = 0.0;
+
+			for (int j = 0; j < options.sweepSteps.size(); j++) {
+				fprintf(stderr, "running %s x %d at a %g s step %s continuous collision...\n", options.layouts[i].c_str(), options.sweepCount,
+					options.sweepSteps[j], result.ccd ? "with" : "without");
+				StepTrial trial = RunStepTrial(layout, options.sweepSteps[j], result.ccd, options, result.ccdBodies);
+				result.trials.push_back(trial);
+
+				// the steps are sorted, so a larger one coming out stable
+				// after a failure would only be luck
+				if (!trial.stable)
+					break;
+				result.maxStableStep = trial.dt;
+				result.throughput = trial.throughput;
+			}
+
+			if (result.ccd && !results.empty()) {
+				const StepSweepResult &without = results.back();
+				if (without.throughput > 0.0)
+					result.throughputGain = result.throughput / without.throughput;
+			}
+			results.push_back(result);
+		}
+	}
+}
+
+static void WriteSweepJSON(FILE* out, const BenchmarkOptions &options, const std::vector<StepSweepResult> &results) {
+	fprintf(out, "{\n");
+	fprintf(out, "  \"benchmark\": \"domino_max_step\",\n");
+	fprintf(out, "  \"max_time\": %g,\n", options.sweepMaxTime);
+	fprintf(out, "  \"wavefront\": %s,\n", options.wavefront ? "true" : "false");
+	fprintf(out, "  \"results\": [\n");
+	for (int i = 0; i < results.size(); i++) {
+		const StepSweepResult &r = results[i];
+		fprintf(out, "    {\n");
+		fprintf(out, "      \"layout\": \"%s\",\n", r.layout.c_str());
+		fprintf(out, "      \"dominos\": %d,\n", r.dominos);
+		fprintf(out, "      \"ccd\": %s,\n", r.ccd ? "true" : "false");
+		fprintf(out, "      \"ccd_bodies\": %d,\n", r.ccdBodies);
+		fprintf(out, "      \"max_stable_dt\": %g,\n", r.maxStableStep);
+		fprintf(out, "      \"throughput\": %.2f,\n", r.throughput);
+		fprintf(out, "      \"throughput_gain\": %.3f,\n", r.throughputGain);
+		fprintf(out, "      \"trials\": [\n");
+		for (int j = 0; j < r.trials.size(); j++) {
+			const StepTrial &t = r.trials[j];
+			fprintf(out, "        { \"dt\": %g, \"stable\": %s, \"toppled\": %d, \"sunk\": %d, \"completion\": %.4f, \"steps\": %d, \"wall_ms\": %.1f, \"throughput\": %.2f }%s\n",
+				t.dt, t.stable ? "true" : "false", t.toppled, t.sunk, t.completionTime, t.steps, t.wallMs, t.throughput,
+				j + 1 < r.trials.size() ? "," : "");
+		}
+		fprintf(out, "      ]\n");
+		fprintf(out, "    }%s\n", i + 1 < results.size() ? "," : "");
+	}
+	fprintf(out, "  ]\n");
+	fprintf(out, "}\n");
+}
+
+static void PrintUsage(const char* program) {
+	printf("usage: %s [--layouts line,double,grid] [--sizes 1000,10000,...] [--threads 1,2,4,...|max] [--broadphases dbvt,sap] [--solvers fast,balanced,accurate] [--steps N] [--dt seconds] [--sample-every N] [--wavefront] [--steady-after N] [--assert-no-allocations] [--no-ccd] [--out file.json]\n", program);
+	printf("       %s --step-sweep dt,dt,... [--layouts line,...] [--sweep-count N] [--sweep-max-time seconds] [--wavefront] [--out file.json]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+	// count from the start, before anything has been handed to Bullet
+	g_allocations.HookBullet();
+
+	BenchmarkOptions options;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--layouts") == 0 && i + 1 < argc) {
+			options.layouts = SplitList(argv[++i]);
+		} else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+			std::vector<std::string> sizes = SplitList(argv[++i]);
+			options.sizes.clear();
+			for (int j = 0; j < sizes.size(); j++)
+				options.sizes.push_back(atoi(sizes[j].c_str()));
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			// "max" doubles from 1 up to every thread the scheduler has
+			options.threads.clear();
+			if (strcmp(argv[++i], "max") == 0) {
+				int maxThreads = PhysicsSimulation::GetMaxThreads();
+				for (int t = 1; t < maxThreads; t *= 2)
+					options.threads.push_back(t);
+				options.threads.push_back(maxThreads);
+			} else {
+				std::vector<std::string> threads = SplitList(argv[i]);
+				for (int j = 0; j < threads.size(); j++)
+					options.threads.push_back(atoi(threads[j].c_str()));
+			}
+		} else if (strcmp(argv[i], "--broadphases") == 0 && i + 1 < argc) {
+			std::vector<std::string> names = SplitList(argv[++i]);
+			options.broadphases.clear();
+			for (int j = 0; j < names.size(); j++) {
+				BroadphaseType type;
+				if (!ParseBroadphaseName(names[j].c_str(), type)) {
+					fprintf(stderr, "unknown broadphase '%s'\n", names[j].c_str());
+					return 1;
+				}
+				options.broadphases.push_back(type);
+			}
+		} else if (strcmp(argv[i], "--solvers") == 0 && i + 1 < argc) {
+			std::vector<std::string> names = SplitList(argv[++i]);
+			options.solvers.clear();
+			for (int j = 0; j < names.size(); j++) {
+				SolverProfile profile;
+				if (!ParseSolverProfileName(names[j].c_str(), profile)) {
+					fprintf(stderr, "unknown solver profile '%s'\n", names[j].c_str());
+					return 1;
+				}
+				options.solvers.push_back(profile);
+			}
+		} else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+			options.steps = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--dt") == 0 && i + 1 < argc) {
+			options.dt = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "--sample-every") == 0 && i + 1 < argc) {
+			options.sampleEvery = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--wavefront") == 0) {
+			options.wavefront = true;
+		} else if (strcmp(argv[i], "--steady-after") == 0 && i + 1 < argc) {
+			options.steadyAfter = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--assert-no-allocations") == 0) {
+			options.assertNoAllocations = true;
+		} else if (strcmp(argv[i], "--no-ccd") == 0) {
+			options.ccd = false;
+		} else if (strcmp(argv[i], "--step-sweep") == 0 && i + 1 < argc) {
+			std::vector<std::string> steps = SplitList(argv[++i]);
+			options.sweepSteps.clear();
+			for (int j = 0; j < steps.size(); j++)
+				options.sweepSteps.push_back((float)atof(steps[j].c_str()));
+		} else if (strcmp(argv[i], "--sweep-count") == 0 && i + 1 < argc) {
+			options.sweepCount = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--sweep-max-time") == 0 && i + 1 < argc) {
+			options.sweepMaxTime = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			options.outputPath = argv[++i];
+		} else {
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	bool validThreads = !options.threads.empty();
+	for (int i = 0; i < options.threads.size(); i++) {
+		if (options.threads[i] <= 0)
+			validThreads = false;
+	}
+
+	if (options.steps <= 0 || options.dt <= 0.0f || options.sampleEvery <= 0 || !validThreads || options.broadphases.empty() || options.solvers.empty()) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	// reject unknown layouts before spending minutes on the known ones
+	DominoLayout check;
+	for (int i = 0; i < options.layouts.size(); i++) {
+		if (!BuildLayoutByName(options.layouts[i], 0, DOMINO_DEFAULT_SPACING, check)) {
+			fprintf(stderr, "unknown layout '%s'\n", options.layouts[i].c_str());
+			return 1;
+		}
+	}
+
+	if (!options.sweepSteps.empty()) {
+		std::sort(options.sweepSteps.begin(), options.sweepSteps.end());
+		if (options.sweepSteps[0] <= 0.0f || options.sweepCount < 2 || options.sweepMaxTime <= 0.0f) {
+			PrintUsage(argv[0]);
+			return 1;
+		}
+
+		std::vector<StepSweepResult> sweep;
+		RunStepSweep(options, sweep);
+
+		FILE* out = stdout;
+		if (options.outputPath) {
+			out = fopen(options.outputPath, "w");
+			if (!out) {
+				fprintf(stderr, "could not open '%s' for writing\n", options.outputPath);
+				return 1;
+			}
+		}
+		WriteSweepJSON(out, options, sweep);
+		if (out != stdout)
+			fclose(out);
+		return 0;
+	}
+
+	// smallest scenes first, so the peak RSS of each result
+	// belongs to the largest scene run so far
+	std::sort(options.sizes.begin(), options.sizes.end());
+	std::sort(options.threads.begin(), options.threads.end());
+	std::sort(options.broadphases.begin(), options.broadphases.end());
+	std::sort(options.solvers.begin(), options.solvers.end());
+
+	std::vector<BenchmarkResult> results;
+	for (int i = 0; i < options.sizes.size(); i++) {
+		for (int j = 0; j < options.layouts.size(); j++) {
+			if (options.sizes[i] < 2)
+				continue;
+			for (int s = 0; s < options.solvers.size(); s++) {
+				// the default broadphase sorts first, so its step times are
+				// there to compare the others against
+				std::vector<double> defaultMeans(options.threads.size(), 0.0);
+				for (int b = 0; b < options.broadphases.size(); b++) {
+					double singleThreadMean = 0.0;
+					for (int k = 0; k < options.threads.size(); k++) {
+						fprintf(stderr, "running %s x %d on %d threads with %s and the %s solver...\n", options.layouts[j].c_str(), options.sizes[i],
+							options.threads[k], GetBroadphaseName(options.broadphases[b]), GetSolverProfileName(options.solvers[s]));
+						BenchmarkResult result = RunBenchmark(options.layouts[j], options.sizes[i], options.threads[k], options.broadphases[b], options.solvers[s], options);
+
+						// thread counts are sorted, so a single threaded run comes first
+						if (result.threads == 1)
+							singleThreadMean = result.stepMean;
+						if (singleThreadMean > 0.0 && result.stepMean > 0.0)
+							result.speedup = singleThreadMean / result.stepMean;
+
+						if (result.broadphase == BROADPHASE_DBVT)
+							defaultMeans[k] = result.stepMean;
+						if (defaultMeans[k] > 0.0 && result.stepMean > 0.0)
+							result.broadphaseSpeedup = defaultMeans[k] / result.stepMean;
+
+						results.push_back(result);
+					}
+				}
+			}
+		}
+	}
+	CompareWithReference(results);
+
+	FILE* out = stdout;
+	if (options.outputPath) {
+		out = fopen(options.outputPath, "w");
+		if (!out) {
+			fprintf(stderr, "could not open '%s' for writing\n", options.outputPath);
+			return 1;
+		}
+	}
+
+	WriteJSON(out, options, results);
+
+	if (out != stdout)
+		fclose(out);
+
+	// the JSON is written either way so a failing run can be looked into
+	if (options.assertNoAllocations) {
+		bool allocated = false;
+		for (int i = 0; i < results.size(); i++) {
+			const BenchmarkResult &r = results[i];
+			if (r.steadyStepsAllocating == 0)
+				continue;
+			fprintf(stderr, "%s %d dominos, %d threads, %s: %llu allocations in %d steady steps\n",
+				r.layout.c_str(), r.dominos, r.threads, GetBroadphaseName(r.broadphase),
+				r.steadyAllocations, r.steadyStepsAllocating);
+			allocated = true;
+		}
+		if (allocated)
+			return 2;
+	}
+	return 0;
+}
@@ -0,0 +1,166 @@
+#include "DominoLayout.h"
+
+#include <cmath>
+
+// dominos are 1 unit wide, so lines 2 units apart never touch
+#define LINE_GAP 2.0f
+
+// radius of the innermost turn of a spiral. Much tighter and
+// neighbouring dominos overlap on the inside of the bend
+#define SPIRAL_START_RADIUS 4.0f
+
+// how far a curve swings either side of straight ahead, and how many
+// dominos it takes to swing back again
+#define CURVE_MAX_HEADING (SIMD_PI / 3.0f)
+#define CURVE_PERIOD 48
+
+btQuaternion DominoOrientation(btScalar heading) {
+	// the domino's box is built lying down and stood on its end by a
+	// quarter turn around z. Turning around y afterwards spins it
+	// about its own long axis, so it stays standing
+	btQuaternion standing(btVector3(0,0,1), SIMD_HALF_PI);
+	return btQuaternion(btVector3(0,1,0), heading) * standing;
+}
+
+void DominoLayout::Add(const btVector3 &position, btScalar heading) {
+	DominoPlacement placement;
+	placement.position = position;
+	placement.orientation = DominoOrientation(heading);
+
+	if (placements.empty()) {
+		boundsMin = position;
+		boundsMax = position;
+	} else {
+		boundsMin.setMin(position);
+		boundsMax.setMax(position);
+	}
+
+	placements.push_back(placement);
+}
+
+// extra ground around the layout so dominos can't fall off the edge
+#define GROUND_MARGIN 10.0f
+
+void DominoLayout::GetGround(btVector3 &centre, btVector3 &halfExtents) const {
+	btVector3 middle = 0.5f * (boundsMin + boundsMax);
+	btVector3 halfSize = 0.5f * (boundsMax - boundsMin);
+
+	centre = btVector3(middle.x(), 0.0f, middle.z());
+	halfExtents = btVector3(1.0f, halfSize.x() + GROUND_MARGIN, halfSize.z() + GROUND_MARGIN);
+}
+
+// lays out `lines` parallel lines of `perLine` dominos, filling them
+// one line at a time so each chain is contiguous in the placement list
+static void BuildParallelLines(DominoLayout &layout, int count, int lines, float spacing) {
+	int perLine = (count + lines - 1) / lines;
+	float y = GROUND_TOP + DOMINO_STANDING_HEIGHT;
+
+	// centre the block of lines on x = 0
+	float x0 = -0.5f * LINE_GAP * (lines - 1);
+
+	layout.placements.reserve(count);
+	for (int line = 0; line < lines && (int)layout.placements.size() < count; line++) {
+		layout.leads.push_back((int)layout.placements.size());
+
+		float x = x0 + line * LINE_GAP;
+		for (int i = 0; i < perLine && (int)layout.placements.size() < count; i++)
+			layout.Add(btVector3(x, y, i * spacing));
+	}
+}
+
+DominoLayout BuildLineLayout(int count, float spacing) {
+	DominoLayout layout;
+	layout.name = "line";
+	BuildParallelLines(layout, count, 1, spacing);
+	return layout;
+}
+
+DominoLayout BuildDoubleRowLayout(int count, float spacing) {
+	DominoLayout layout;
+	layout.name = "double";
+	BuildParallelLines(layout, count, 2, spacing);
+	return layout;
+}
+
+DominoLayout BuildGridLayout(int count, float spacing) {
+	DominoLayout layout;
+	layout.name = "grid";
+
+	// pick the number of lines so the block comes out roughly square
+	int lines = (int)sqrt(count * spacing / LINE_GAP);
+	if (lines < 1)
+		lines = 1;
+
+	BuildParallelLines(layout, count, lines, spacing);
+	return layout;
+}
+
+DominoLayout BuildSpiralLayout(int count, float spacing) {
+	DominoLayout layout;
+	layout.name = "spiral";
+	layout.leads.push_back(0);
+	layout.placements.reserve(count);
+
+	// r = a + b * theta, with b chosen so each turn is one line gap
+	// further out than the last
+	float a = SPIRAL_START_RADIUS;
+	float b = LINE_GAP / SIMD_2_PI;
+	float y = GROUND_TOP + DOMINO_STANDING_HEIGHT;
+
+	float theta = 0.0f;
+	for (int i = 0; i < count; i++) {
+		float r = a + b * theta;
+		float c = cos(theta);
+		float s = sin(theta);
+
+		// face along the spiral's tangent, so each domino falls onto the next
+		float tx = b * c - r * s;
+		float tz = b * s + r * c;
+		layout.Add(btVector3(r * c, y, r * s), atan2(tx, tz));
+
+		// the arc length of a small step in theta is
+		// sqrt(r^2 + b^2) * dtheta, so this keeps the spacing even
+		theta += spacing / sqrt(r * r + b * b);
+	}
+	return layout;
+}
+
+DominoLayout BuildCurveLayout(int count, float spacing) {
+	DominoLayout layout;
+	layout.name = "curve";
+	layout.leads.push_back(0);
+	layout.placements.reserve(count);
+
+	float y = GROUND_TOP + DOMINO_STANDING_HEIGHT;
+	btVector3 position(0, y, 0);
+
+	// the heading swings back and forth as a sine wave, and each domino
+	// is placed one spacing on from the last along the average of the
+	// two headings, so the chain follows the bend
+	btScalar heading = 0.0f;
+	for (int i = 0; i < count; i++) {
+		layout.Add(position, heading);
+
+		btScalar next = CURVE_MAX_HEADING * sin(SIMD_2_PI * (i + 1) / CURVE_PERIOD);
+		btScalar middle = 0.5f * (heading + next);
+		position += spacing * btVector3(sin(middle), 0, cos(middle));
+		heading = next;
+	}
+	return layout;
+}
+
+bool BuildLayoutByName(const std::string &name, int count, float spacing, DominoLayout &layout) {
+	if (name == "line")
+		layout = BuildLineLayout(count, spacing);
+	else if (name == "double")
+		layout = BuildDoubleRowLayout(count, spacing);
+	else if (name == "grid")
+		layout = BuildGridLayout(count, spacing);
+	else if (name == "spiral")
+		layout = BuildSpiralLayout(count, spacing);
+	else if (name == "curve")
+		layout = BuildCurveLayout(count, spacing);
+	else
+		return false;
+	return true;
+}
@@ -0,0 +1,87 @@
+#ifndef _DOMINOLAYOUT_H_
+#define _DOMINOLAYOUT_H_
+
+#include "btBulletDynamicsCommon.h"
+#include <string>
+#include <vector>
+
+// the ground's top face sits at y = 1
+#define GROUND_TOP 1.0f
+
+// height of a standing domino's centre above the top of the ground
+// (the domino is 2 units tall once it is stood on its end)
+#define DOMINO_STANDING_HEIGHT 1.0f
+
+// default gap between the centres of two neighbouring dominos
+#define DOMINO_DEFAULT_SPACING 1.5f
+
+// a domino's box, lying down, and its mass
+#define DOMINO_HALF_EXTENTS btVector3(1.0f, 0.5f, 0.1f)
+#define DOMINO_MASS 5.0f
+
+// Bullet's default friction, and the force the lead dominos are
+// pushed with each update until the first one hits the second
+#define DOMINO_FRICTION 0.5f
+#define DOMINO_PUSH_FORCE 7.0f
+
+// a domino counts as fallen once it leans this far from upright. Dominos
+// in a chain come to rest leaning on the next one, at about 35 degrees
+// for the closest spacing that still topples, so this has to be below that
+#define DOMINO_TOPPLE_COS 0.866f	// cos(30 degrees)
+
+// the orientation of a standing domino facing heading radians around
+// the y axis. A heading of 0 faces +z, so the domino falls towards +z
+btQuaternion DominoOrientation(btScalar heading);
+
+// where a single domino goes, and how it is rotated
+struct DominoPlacement {
+	btVector3 position;
+	btQuaternion orientation;
+};
+
+// a procedurally generated set of dominos. Placements are stored in
+// toppling order, and every chain's first domino is listed in leads
+// so the simulation knows what to push to start the run
+struct DominoLayout {
+	std::string name;
+	std::vector<DominoPlacement> placements;
+	std::vector<int> leads;
+
+	// axis-aligned bounds of every placement, used to size the ground
+	btVector3 boundsMin;
+	btVector3 boundsMax;
+
+	DominoLayout() : boundsMin(0,0,0), boundsMax(0,0,0) {}
+
+	// append a domino and grow the bounds to fit it
+	void Add(const btVector3 &position, btScalar heading = 0.0f);
+
+	// where the ground box goes and how big it is to hold every domino
+	// with room to spare. The ground box is stood on its side by the
+	// default object rotation, so its local y and z cover the world's x and z
+	void GetGround(btVector3 &centre, btVector3 &halfExtents) const;
+};
+
+// one straight line of count dominos running along +z
+DominoLayout BuildLineLayout(int count, float spacing = DOMINO_DEFAULT_SPACING);
+
+// two parallel lines side by side, count dominos in total
+DominoLayout BuildDoubleRowLayout(int count, float spacing = DOMINO_DEFAULT_SPACING);
+
+// a square-ish block of parallel lines, count dominos in total, with
+// every line pushed at once so the whole front falls together
+DominoLayout BuildGridLayout(int count, float spacing = DOMINO_DEFAULT_SPACING);
+
+// a single chain wound into an Archimedean spiral, starting at the
+// centre and working outwards, with one line gap between the turns
+DominoLayout BuildSpiralLayout(int count, float spacing = DOMINO_DEFAULT_SPACING);
+
+// a single chain snaking from side to side as it runs along +z
+DominoLayout BuildCurveLayout(int count, float spacing = DOMINO_DEFAULT_SPACING);
+
+// looks up a builder by name ("line", "double", "grid", "spiral",
+// "curve"). Returns
+// false and leaves layout untouched if the name is unknown
+bool BuildLayoutByName(const std::string &name, int count, float spacing, DominoLayout &layout);
+
+#endif
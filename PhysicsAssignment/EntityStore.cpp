@@ -0,0 +1,148 @@
+#include "EntityStore.h"
+
+EntityStore::EntityStore(ShapeRegistry &shapes)
+:
+m_shapes(shapes)
+{
+}
+
+EntityStore::~EntityStore() {
+	Clear();
+}
+
+EntityHandle EntityStore::Create(const EntityDesc &desc) {
+	// pick a slot, reusing a freed one if we can
+	unsigned int index;
+	if (!m_freeSlots.empty()) {
+		index = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	} else {
+		index = (unsigned int)m_slots.size();
+		btAssert(index <= EntityHandle::INDEX_MASK);
+
+		// generation 0 is reserved for the null handle
+		Slot slot;
+		slot.dense = -1;
+		slot.generation = 1;
+		m_slots.push_back(slot);
+	}
+
+	Slot &slot = m_slots[index];
+	slot.dense = (int)m_entities.size();
+	EntityHandle handle(index, slot.generation);
+
+	// create the initial transform
+	btTransform transform;
+	transform.setIdentity();
+	transform.setOrigin(desc.position);
+	transform.setRotation(desc.orientation);
+
+	// create the motion state from the
+	// initial transform
+	OpenGLMotionState* pMotionState = m_motionStates.Create(transform);
+	pMotionState->SetDirtyList(&m_dirtyHandles, handle.value);
+
+	// the local inertia comes from the registry's cached copy
+	btVector3 localInertia = m_shapes.GetLocalInertia(desc.pShape, desc.mass);
+
+	// create the rigid body construction
+	// info using the mass, motion state
+	// and shape
+	btRigidBody::btRigidBodyConstructionInfo cInfo(desc.mass, pMotionState, desc.pShape, localInertia);
+
+	// create the rigid body
+	btRigidBody* pBody = m_bodies.Create(cInfo);
+	pBody->setUserPointer(handle.ToUserPointer());
+
+	Entity entity;
+	entity.pBody = pBody;
+	entity.pMotionState = pMotionState;
+	entity.pShape = desc.pShape;
+	entity.color = desc.color;
+	entity.kind = desc.kind;
+	entity.handle = handle;
+	m_entities.push_back(entity);
+	TransformToMatrix(transform, m_matrices.expand());
+
+	return handle;
+}
+
+void EntityStore::Destroy(EntityHandle handle) {
+	Entity* pEntity = Get(handle);
+	if (!pEntity)
+		return;
+
+	m_bodies.Destroy(pEntity->pBody);
+	m_motionStates.Destroy(pEntity->pMotionState);
+	m_shapes.Release(pEntity->pShape);
+
+	// fill the hole with the last entity so the array stays packed
+	Slot &slot = m_slots[handle.GetIndex()];
+	int hole = slot.dense;
+	int last = (int)m_entities.size() - 1;
+	if (hole != last) {
+		m_entities[hole] = m_entities[last];
+		m_matrices[hole] = m_matrices[last];
+		m_slots[m_entities[hole].handle.GetIndex()].dense = hole;
+	}
+	m_entities.pop_back();
+	m_matrices.pop_back();
+
+	// retire the slot. Bumping the generation makes every
+	// outstanding handle to it stale, skipping the null generation
+	slot.dense = -1;
+	slot.generation = (slot.generation + 1) & EntityHandle::GENERATION_MASK;
+	if (slot.generation == 0)
+		slot.generation = 1;
+	m_freeSlots.push_back(handle.GetIndex());
+}
+
+void EntityStore::Clear() {
+	while (!m_entities.empty())
+		Destroy(m_entities.back().handle);
+	m_dirtyHandles.clear();
+}
+
+void EntityStore::Reserve(int count) {
+	m_entities.reserve(m_entities.size() + count);
+	m_slots.reserve(m_slots.size() + count);
+	m_matrices.reserve(m_matrices.size() + count);
+	m_bodies.Reserve(count);
+	m_motionStates.Reserve(count);
+}
+
+int EntityStore::UpdateDirtyTransforms() {
+	int updated = 0;
+	for (int i = 0; i < m_dirtyHandles.size(); i++) {
+		EntityHandle handle;
+		handle.value = m_dirtyHandles[i];
+
+		Entity* pEntity = Get(handle);
+		if (!pEntity)
+			continue;
+
+		// the motion state holds the transform Bullet last gave it
+		OpenGLMotionState* pMotionState = pEntity->pMotionState;
+		TransformToMatrix(pMotionState->m_graphicsWorldTrans, m_matrices[GetDenseIndex(*pEntity)]);
+		pMotionState->ClearDirty();
+		updated++;
+	}
+	m_dirtyHandles.clear();
+	return updated;
+}
+
+Entity* EntityStore::Get(EntityHandle handle) {
+	unsigned int index = handle.GetIndex();
+	if (index >= m_slots.size())
+		return 0;
+
+	const Slot &slot = m_slots[index];
+	if (slot.dense < 0 || slot.generation != handle.GetGeneration())
+		return 0;
+
+	return &m_entities[slot.dense];
+}
+
+const Entity* EntityStore::Get(EntityHandle handle) const {
+	return const_cast<EntityStore*>(this)->Get(handle);
+}
@@ -0,0 +1,148 @@
+#ifndef _ENTITYSTORE_H_
+#define _ENTITYSTORE_H_
+
+#include "btBulletDynamicsCommon.h"
+
+#include "MatrixBatch.h"
+#include "OpenGLMotionState.h"
+#include "ShapeRegistry.h"
+#include "ObjectPool.h"
+
+#include <vector>
+
+// refers to one entity in an EntityStore. The low bits are the entity's
+// slot and the high bits a generation count that changes every time the
+// slot is reused, so a handle to a destroyed entity can never pick up
+// whatever took its place. It is small enough to live in a rigid body's
+// user pointer
+struct EntityHandle {
+	enum {
+		INDEX_BITS = 22,
+		INDEX_MASK = (1 << INDEX_BITS) - 1,
+		GENERATION_MASK = (1 << (32 - INDEX_BITS)) - 1
+	};
+
+	unsigned int value;
+
+	EntityHandle() : value(0) {}
+	EntityHandle(unsigned int index, unsigned int generation) : value(((generation & GENERATION_MASK) << INDEX_BITS) | (index & INDEX_MASK)) {}
+
+	unsigned int GetIndex() const { return value & INDEX_MASK; }
+	unsigned int GetGeneration() const { return value >> INDEX_BITS; }
+
+	// generation 0 is never handed out, so an all-zero handle is null
+	bool IsValid() const { return value != 0; }
+
+	bool operator==(const EntityHandle &other) const { return value == other.value; }
+	bool operator!=(const EntityHandle &other) const { return value != other.value; }
+
+	// round trip through a btCollisionObject's user pointer
+	void* ToUserPointer() const { return (void*)(size_t)value; }
+	static EntityHandle FromUserPointer(void* pointer) { EntityHandle handle; handle.value = (unsigned int)(size_t)pointer; return handle; }
+};
+
+// what sort of thing an entity is
+enum EntityKind {
+	ENTITY_DOMINO,
+	ENTITY_OBJECT
+};
+
+// everything needed to build an entity
+struct EntityDesc {
+	EntityKind kind;
+	btCollisionShape* pShape;	// acquired from the store's registry, which the entity takes over
+	btScalar mass;
+	btVector3 color;
+	btVector3 position;
+	btQuaternion orientation;
+
+	EntityDesc() : kind(ENTITY_OBJECT), pShape(0), mass(0), color(1,1,1), position(0,0,0), orientation(0,0,1,1) {}
+};
+
+// one entity's data. Entities are packed together in one array, so
+// walking every entity touches contiguous memory rather than chasing a
+// pointer per object
+struct Entity {
+	btRigidBody* pBody;
+	OpenGLMotionState* pMotionState;
+	btCollisionShape* pShape;
+	btVector3 color;
+	EntityKind kind;
+	EntityHandle handle;
+};
+
+// owns every body in a scene. Rigid bodies and motion states come from
+// slab pools, per-entity data lives in one dense array, and entities are
+// named by generational handles. Every entity's OpenGL matrix is kept
+// in a second dense array alongside, in the same order, so drawing reads
+// matrices from one contiguous buffer. Creating and destroying are O(1):
+// destroying moves the last entity into the hole, so the dense order is
+// not stable, but handles are
+class EntityStore {
+public:
+	EntityStore(ShapeRegistry &shapes);
+	~EntityStore();
+
+	// build an entity's body and motion state. The body's user pointer is
+	// set to the new handle. Adding it to a world is up to the caller
+	EntityHandle Create(const EntityDesc &desc);
+
+	// tear down an entity. Its body must already be out of the world
+	void Destroy(EntityHandle handle);
+
+	// destroy everything
+	void Clear();
+
+	// make room for count more entities without further allocation
+	void Reserve(int count);
+
+	// look up a live entity, or 0 if the handle is stale
+	Entity* Get(EntityHandle handle);
+	const Entity* Get(EntityHandle handle) const;
+
+	// find the entity owning a body made by this store
+	Entity* FromBody(const btCollisionObject* pBody) { return Get(EntityHandle::FromUserPointer(pBody->getUserPointer())); }
+	const Entity* FromBody(const btCollisionObject* pBody) const { return Get(EntityHandle::FromUserPointer(pBody->getUserPointer())); }
+
+	// rebuild the matrices of the entities that have moved since the
+	// last call, in one pass. Only awake bodies move, so this costs
+	// nothing for the sleeping ones. Returns how many were rebuilt
+	int UpdateDirtyTransforms();
+
+	// the dense array, for walking every entity
+	int GetNumEntities() const { return (int)m_entities.size(); }
+	Entity& GetEntity(int i) { return m_entities[i]; }
+	const Entity& GetEntity(int i) const { return m_entities[i]; }
+
+	// entity i's OpenGL matrix, current as of the last UpdateDirtyTransforms()
+	const btScalar* GetMatrix(int i) const { return m_matrices[i].m; }
+	const btScalar* GetMatrix(const Entity &entity) const { return GetMatrix(GetDenseIndex(entity)); }
+
+	// every entity's matrix, in dense order
+	const OpenGLMatrix* GetMatrices() const { return m_matrices.size() ? &m_matrices[0] : 0; }
+
+private:
+	struct Slot {
+		int dense;			// position in m_entities, or -1 when free
+		unsigned int generation;
+	};
+
+	// where an entity from the dense array sits in it
+	int GetDenseIndex(const Entity &entity) const { return (int)(&entity - &m_entities[0]); }
+
+	ShapeRegistry &m_shapes;
+
+	std::vector<Entity> m_entities;
+	btAlignedObjectArray<OpenGLMatrix> m_matrices;
+	std::vector<Slot> m_slots;
+	std::vector<unsigned int> m_freeSlots;
+
+	// handles of the entities whose motion states have changed. Entities
+	// destroyed since they were added are skipped as stale handles
+	std::vector<unsigned int> m_dirtyHandles;
+
+	ObjectPool<btRigidBody> m_bodies;
+	ObjectPool<OpenGLMotionState> m_motionStates;
+};
+
+#endif
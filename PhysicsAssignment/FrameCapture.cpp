@@ -0,0 +1,274 @@
+#include "FrameCapture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+FrameCapture::FrameCapture()
+:
+m_width(0),
+m_height(0),
+m_usePackBuffers(false),
+m_nextPackBuffer(0),
+m_pendingFrame(-1),
+m_nextFrame(0),
+m_stopping(false)
+{
+	m_packBuffers[0] = 0;
+	m_packBuffers[1] = 0;
+}
+
+FrameCapture::~FrameCapture() {
+	Finish();
+}
+
+bool FrameCapture::Start(const char* prefix, int width, int height, int numImages) {
+	Finish();
+
+	// TGA sizes are 16 bit
+	if (width <= 0 || height <= 0 || width > 65535 || height > 65535 || numImages < 1)
+		return false;
+
+	m_prefix = prefix;
+	m_width = width;
+	m_height = height;
+	m_nextFrame = 0;
+	m_pendingFrame = -1;
+	m_nextPackBuffer = 0;
+
+	size_t frameSize = (size_t)width * height * 4;
+	m_images.resize(numImages);
+	m_free.clear();
+	for (int i = 0; i < numImages; i++) {
+		m_images[i].pixels.resize(frameSize);
+		m_free.push_back(i);
+	}
+	m_queue.clear();
+	m_stats = CaptureStats();
+	m_stopping = false;
+
+	// two pack buffers, so one can be copied out while the other fills
+	LoadGLExtensions();
+	m_usePackBuffers = HasBufferObjects() && pglMapBuffer && pglUnmapBuffer;
+	if (m_usePackBuffers) {
+		pglGenBuffers(2, m_packBuffers);
+		for (int i = 0; i < 2; i++) {
+			pglBindBuffer(GL_PIXEL_PACK_BUFFER, m_packBuffers[i]);
+			pglBufferData(GL_PIXEL_PACK_BUFFER, frameSize, 0, GL_STREAM_READ);
+		}
+		pglBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	// rows of BGRA pixels are always a multiple of 4 bytes
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	m_writer = std::thread(&FrameCapture::WriterLoop, this);
+	return true;
+}
+
+void FrameCapture::CaptureFrame() {
+	if (!IsCapturing())
+		return;
+
+	int frame = m_nextFrame++;
+
+	if (!m_usePackBuffers) {
+		int image = AcquireImage();
+		m_images[image].frame = frame;
+		glReadPixels(0, 0, m_width, m_height, GL_BGRA, GL_UNSIGNED_BYTE, &m_images[image].pixels[0]);
+		Submit(image);
+		return;
+	}
+
+	// start this frame's read back. With a pack buffer bound it only
+	// queues the copy, it doesn't wait for it
+	pglBindBuffer(GL_PIXEL_PACK_BUFFER, m_packBuffers[m_nextPackBuffer]);
+	glReadPixels(0, 0, m_width, m_height, GL_BGRA, GL_UNSIGNED_BYTE, 0);
+
+	// the last frame's has had a whole frame to finish
+	if (m_pendingFrame >= 0)
+		CollectPending(m_nextPackBuffer ^ 1);
+
+	m_pendingFrame = frame;
+	m_nextPackBuffer ^= 1;
+	pglBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void FrameCapture::CollectPending(int packBuffer) {
+	int image = AcquireImage();
+	m_images[image].frame = m_pendingFrame;
+
+	pglBindBuffer(GL_PIXEL_PACK_BUFFER, m_packBuffers[packBuffer]);
+	const void* pPixels = pglMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+	if (pPixels) {
+		memcpy(&m_images[image].pixels[0], pPixels, m_images[image].pixels.size());
+		pglUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		Submit(image);
+	} else {
+		// the frame is lost, but the image can go straight back
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_free.push_back(image);
+	}
+	m_pendingFrame = -1;
+}
+
+void FrameCapture::Finish() {
+	if (!IsCapturing())
+		return;
+
+	// the last frame is still in its pack buffer
+	if (m_usePackBuffers && m_pendingFrame >= 0) {
+		CollectPending(m_nextPackBuffer ^ 1);
+		pglBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	// the writer drains the queue before it stops
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_workQueued.notify_one();
+	m_writer.join();
+
+	if (m_usePackBuffers) {
+		pglDeleteBuffers(2, m_packBuffers);
+		m_packBuffers[0] = 0;
+		m_packBuffers[1] = 0;
+	}
+	m_images.clear();
+}
+
+CaptureStats FrameCapture::GetStats() {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+int FrameCapture::AcquireImage() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_free.empty()) {
+		m_stats.stalls++;
+		while (m_free.empty())
+			m_imageFreed.wait(lock);
+	}
+	int image = m_free.back();
+	m_free.pop_back();
+	return image;
+}
+
+void FrameCapture::Submit(int image) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(image);
+		m_stats.framesCaptured++;
+	}
+	m_workQueued.notify_one();
+}
+
+void FrameCapture::WriterLoop() {
+	// kept for the life of the thread, so encoding doesn't allocate
+	std::vector<unsigned char> encoded;
+
+	for (;;) {
+		int image;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (m_queue.empty() && !m_stopping)
+				m_workQueued.wait(lock);
+			if (m_queue.empty())
+				return;
+			image = m_queue.front();
+			m_queue.pop_front();
+		}
+
+		// the encoding and the disk I/O happen outside the lock
+		bool written = WriteImage(m_images[image], encoded);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_free.push_back(image);
+			if (written) {
+				m_stats.framesWritten++;
+				m_stats.bytesWritten += encoded.size();
+			}
+		}
+		m_imageFreed.notify_one();
+	}
+}
+
+// a pixel's color, ignoring alpha, which isn't written
+static uint32_t ColorAt(const unsigned char* pPixels, int x) {
+	const unsigned char* p = pPixels + x * 4;
+	return p[0] | (p[1] << 8) | (p[2] << 16);
+}
+
+static void PutPixel(std::vector<unsigned char> &out, const unsigned char* pPixels, int x) {
+	const unsigned char* p = pPixels + x * 4;
+	out.push_back(p[0]);
+	out.push_back(p[1]);
+	out.push_back(p[2]);
+}
+
+// run length encode one row as TGA packets of up to 128 pixels. A run
+// packet repeats one pixel, a raw packet lists pixels that don't repeat
+static void EncodeRow(const unsigned char* pRow, int width, std::vector<unsigned char> &out) {
+	int x = 0;
+	while (x < width) {
+		uint32_t color = ColorAt(pRow, x);
+		int run = 1;
+		while (x + run < width && run < 128 && ColorAt(pRow, x + run) == color)
+			run++;
+
+		if (run > 1) {
+			out.push_back((unsigned char)(0x80 | (run - 1)));
+			PutPixel(out, pRow, x);
+			x += run;
+			continue;
+		}
+
+		// gather pixels until the next run starts
+		int raw = 1;
+		while (x + raw < width && raw < 128
+			&& !(x + raw + 1 < width && ColorAt(pRow, x + raw) == ColorAt(pRow, x + raw + 1)))
+			raw++;
+
+		out.push_back((unsigned char)(raw - 1));
+		for (int i = 0; i < raw; i++)
+			PutPixel(out, pRow, x + i);
+		x += raw;
+	}
+}
+
+bool FrameCapture::WriteImage(const Image &image, std::vector<unsigned char> &encoded) {
+	// a 24 bit run length encoded TGA. Its rows run bottom to top by
+	// default, the same as glReadPixels() returns them
+	unsigned char header[18];
+	memset(header, 0, sizeof(header));
+	header[2] = 10;
+	header[12] = (unsigned char)(m_width & 0xff);
+	header[13] = (unsigned char)(m_width >> 8);
+	header[14] = (unsigned char)(m_height & 0xff);
+	header[15] = (unsigned char)(m_height >> 8);
+	header[16] = 24;
+
+	// the worst case is every pixel raw, plus a packet header every 128
+	size_t rowSize = (size_t)m_width * 4;
+	encoded.clear();
+	encoded.reserve(sizeof(header) + (size_t)m_height * (m_width * 3 + (m_width + 127) / 128));
+	encoded.insert(encoded.end(), header, header + sizeof(header));
+	for (int y = 0; y < m_height; y++)
+		EncodeRow(&image.pixels[y * rowSize], m_width, encoded);
+
+	char number[16];
+	sprintf(number, "%05d.tga", image.frame);
+	std::string path = m_prefix + number;
+
+	FILE* pFile = fopen(path.c_str(), "wb");
+	if (!pFile) {
+		printf("could not write frame '%s'\n", path.c_str());
+		return false;
+	}
+	bool ok = fwrite(&encoded[0], 1, encoded.size(), pFile) == encoded.size();
+	if (fclose(pFile) != 0)
+		ok = false;
+	return ok;
+}
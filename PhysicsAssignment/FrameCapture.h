@@ -0,0 +1,97 @@
+#ifndef _FRAMECAPTURE_H_
+#define _FRAMECAPTURE_H_
+
+#include "GLExtensions.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// how a capture is getting on
+struct CaptureStats {
+	int framesCaptured;			// frames read back from OpenGL
+	int framesWritten;			// frames on disk
+	int stalls;					// times the render loop waited for the writer
+	unsigned long long bytesWritten;
+
+	CaptureStats() : framesCaptured(0), framesWritten(0), stalls(0), bytesWritten(0) {}
+};
+
+// saves every rendered frame as a numbered image, without the render loop
+// waiting on the GPU or the disk. Frames are read back into two pixel pack
+// buffers in turn: glReadPixels() into one returns straight away, and the
+// other, read a frame earlier and finished by now, is copied out. The copy
+// goes into one of a few image buffers handed to a writer thread, which
+// encodes it as a run length encoded TGA and writes it out. The render
+// loop only waits if the writer falls a whole set of buffers behind.
+// Without pixel buffer objects the read back is synchronous, but the
+// encoding and writing still happen on the writer thread
+class FrameCapture {
+public:
+	FrameCapture();
+	~FrameCapture();
+
+	// start capturing frames of the given size. They are written as
+	// <prefix>00000.tga, <prefix>00001.tga and so on. Needs a current
+	// OpenGL context
+	bool Start(const char* prefix, int width, int height, int numImages = 4);
+
+	// queue the frame that has just been rendered. Call after rendering
+	// and before swapping buffers, with the context that rendered it current
+	void CaptureFrame();
+
+	// write out every frame still in flight and stop the writer
+	void Finish();
+
+	bool IsCapturing() const { return m_writer.joinable(); }
+
+	CaptureStats GetStats();
+
+private:
+	// not copyable, the writer thread belongs to one object
+	FrameCapture(const FrameCapture &);
+	FrameCapture& operator=(const FrameCapture &);
+
+	struct Image {
+		std::vector<unsigned char> pixels;	// BGRA, bottom row first
+		int frame;
+	};
+
+	// take a free image, waiting for the writer if there isn't one
+	int AcquireImage();
+	void Submit(int image);
+
+	// copy the frame waiting in a pack buffer into an image
+	void CollectPending(int packBuffer);
+
+	void WriterLoop();
+	bool WriteImage(const Image &image, std::vector<unsigned char> &encoded);
+
+	std::string m_prefix;
+	int m_width;
+	int m_height;
+
+	GLuint m_packBuffers[2];
+	bool m_usePackBuffers;
+	int m_nextPackBuffer;
+	int m_pendingFrame;		// the frame waiting in the other pack buffer, or -1
+	int m_nextFrame;
+
+	std::vector<Image> m_images;
+
+	// shared with the writer thread, guarded by m_mutex
+	std::mutex m_mutex;
+	std::condition_variable m_workQueued;
+	std::condition_variable m_imageFreed;
+	std::vector<int> m_free;
+	std::deque<int> m_queue;
+	bool m_stopping;
+	CaptureStats m_stats;
+
+	std::thread m_writer;
+};
+
+#endif
@@ -0,0 +1,229 @@
+#include "FrameProfiler.h"
+
+#include "LinearMath/btQuickprof.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _MSC_VER
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL __thread
+#endif
+
+// everything is timed against one clock started with the program.
+// btClock reads the performance counter, where the standard library's
+// high resolution clock on VS2013 only ticks every millisecond or more
+static btClock s_clock;
+
+FrameProfiler g_profiler;
+
+static const char* s_phaseNames[NUM_PROFILE_PHASES] = {
+	"step",
+	"broadphase",
+	"narrowphase",
+	"solver",
+	"integrate",
+	"collision_events",
+	"camera",
+	"render",
+	"swap",
+	"frame"
+};
+
+// which of Bullet's profile zones count towards which phase. Any zone
+// not listed is ignored, along with everything inside it that isn't
+// listed either
+struct ZonePhase {
+	const char* name;
+	ProfilePhase phase;
+};
+
+static const ZonePhase s_zonePhases[] = {
+	{ "updateAabbs", PHASE_BROADPHASE },
+	{ "calculateOverlappingPairs", PHASE_BROADPHASE },
+	{ "dispatchAllCollisionPairs", PHASE_NARROWPHASE },
+	{ "solveConstraints", PHASE_SOLVER },
+	{ "predictUnconstraintMotion", PHASE_INTEGRATE },
+	{ "integrateTransforms", PHASE_INTEGRATE }
+};
+
+// Bullet's zones nest, and are entered on whichever thread does the
+// work, so each thread keeps its own stack of open zones. Only plain
+// data can be thread local in every compiler this builds with
+#define MAX_ZONE_DEPTH 64
+
+struct OpenZone {
+	int phase;					// a ProfilePhase, or -1 for a zone we don't time
+	unsigned long long start;
+};
+
+static PROFILER_THREAD_LOCAL OpenZone s_zones[MAX_ZONE_DEPTH];
+static PROFILER_THREAD_LOCAL int s_zoneDepth;
+
+static void EnterZone(const char* name) {
+	int depth = s_zoneDepth++;
+	if (depth >= MAX_ZONE_DEPTH)
+		return;
+
+	// the depth is still counted while the profiler is off, so turning
+	// it on in the middle of a step doesn't mismatch the zones
+	s_zones[depth].phase = -1;
+	if (!g_profiler.IsEnabled())
+		return;
+
+	for (int i = 0; i < sizeof(s_zonePhases) / sizeof(s_zonePhases[0]); i++) {
+		if (strcmp(name, s_zonePhases[i].name) == 0) {
+			s_zones[depth].phase = s_zonePhases[i].phase;
+			s_zones[depth].start = FrameProfiler::Now();
+			break;
+		}
+	}
+}
+
+static void LeaveZone() {
+	// a zone entered before the hooks went in is left after
+	if (s_zoneDepth == 0)
+		return;
+
+	int depth = --s_zoneDepth;
+	if (depth >= MAX_ZONE_DEPTH || s_zones[depth].phase < 0)
+		return;
+	g_profiler.Add((ProfilePhase)s_zones[depth].phase, FrameProfiler::Now() - s_zones[depth].start);
+}
+
+FrameProfiler::FrameProfiler(int capacity)
+:
+m_enabled(false),
+m_hooked(false),
+m_frameStart(0),
+m_frames(capacity),
+m_next(0),
+m_count(0)
+{
+	for (int i = 0; i < NUM_PROFILE_PHASES; i++)
+		m_current[i] = 0;
+}
+
+FrameProfiler::~FrameProfiler() {
+}
+
+unsigned long long FrameProfiler::Now() {
+	return s_clock.getTimeMicroseconds();
+}
+
+void FrameProfiler::SetEnabled(bool enabled) {
+	if (enabled == IsEnabled())
+		return;
+
+	if (enabled) {
+		if (!m_hooked) {
+			btSetCustomEnterProfileZoneFunc(EnterZone);
+			btSetCustomLeaveProfileZoneFunc(LeaveZone);
+			m_hooked = true;
+		}
+
+		// start the first frame afresh
+		for (int i = 0; i < NUM_PROFILE_PHASES; i++)
+			m_current[i] = 0;
+		m_frameStart = Now();
+	}
+	m_enabled = enabled;
+}
+
+void FrameProfiler::EndFrame() {
+	if (!IsEnabled() || m_frames.empty())
+		return;
+
+	unsigned long long now = Now();
+	ProfileFrame &frame = m_frames[m_next];
+	for (int i = 0; i < NUM_PROFILE_PHASES; i++)
+		frame.ms[i] = m_current[i].exchange(0, std::memory_order_relaxed) / 1000.0f;
+	frame.ms[PHASE_FRAME] = (now - m_frameStart) / 1000.0f;
+	m_frameStart = now;
+
+	m_next = (m_next + 1) % (int)m_frames.size();
+	if (m_count < (int)m_frames.size())
+		m_count++;
+}
+
+const ProfileFrame& FrameProfiler::GetFrame(int i) const {
+	int oldest = m_next - m_count;
+	if (oldest < 0)
+		oldest += (int)m_frames.size();
+	return m_frames[(oldest + i) % m_frames.size()];
+}
+
+void FrameProfiler::GetAverage(int count, ProfileFrame &average) const {
+	for (int i = 0; i < NUM_PROFILE_PHASES; i++)
+		average.ms[i] = 0.0f;
+
+	if (count > m_count)
+		count = m_count;
+	if (count <= 0)
+		return;
+
+	for (int i = m_count - count; i < m_count; i++) {
+		const ProfileFrame &frame = GetFrame(i);
+		for (int j = 0; j < NUM_PROFILE_PHASES; j++)
+			average.ms[j] += frame.ms[j];
+	}
+	for (int i = 0; i < NUM_PROFILE_PHASES; i++)
+		average.ms[i] /= count;
+}
+
+const char* FrameProfiler::GetPhaseName(ProfilePhase phase) {
+	return s_phaseNames[phase];
+}
+
+bool FrameProfiler::ExportCsv(const char* path) const {
+	FILE* pFile = fopen(path, "w");
+	if (!pFile)
+		return false;
+
+	fprintf(pFile, "frame");
+	for (int i = 0; i < NUM_PROFILE_PHASES; i++)
+		fprintf(pFile, ",%s_ms", s_phaseNames[i]);
+	fprintf(pFile, "\n");
+
+	for (int i = 0; i < m_count; i++) {
+		const ProfileFrame &frame = GetFrame(i);
+		fprintf(pFile, "%d", i);
+		for (int j = 0; j < NUM_PROFILE_PHASES; j++)
+			fprintf(pFile, ",%.4f", frame.ms[j]);
+		fprintf(pFile, "\n");
+	}
+
+	bool ok = !ferror(pFile);
+	if (fclose(pFile) != 0)
+		ok = false;
+	return ok;
+}
+
+bool FrameProfiler::ExportJson(const char* path) const {
+	FILE* pFile = fopen(path, "w");
+	if (!pFile)
+		return false;
+
+	ProfileFrame average;
+	GetAverage(m_count, average);
+
+	fprintf(pFile, "{\n  \"frames\": %d,\n  \"average_ms\": {", m_count);
+	for (int i = 0; i < NUM_PROFILE_PHASES; i++)
+		fprintf(pFile, "%s\"%s\": %.4f", i ? ", " : "", s_phaseNames[i], average.ms[i]);
+	fprintf(pFile, "},\n  \"samples\": [\n");
+
+	for (int i = 0; i < m_count; i++) {
+		const ProfileFrame &frame = GetFrame(i);
+		fprintf(pFile, "    {");
+		for (int j = 0; j < NUM_PROFILE_PHASES; j++)
+			fprintf(pFile, "%s\"%s\": %.4f", j ? ", " : "", s_phaseNames[j], frame.ms[j]);
+		fprintf(pFile, "}%s\n", i + 1 < m_count ? "," : "");
+	}
+	fprintf(pFile, "  ]\n}\n");
+
+	bool ok = !ferror(pFile);
+	if (fclose(pFile) != 0)
+		ok = false;
+	return ok;
+}
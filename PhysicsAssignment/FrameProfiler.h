@@ -0,0 +1,113 @@
+#ifndef _FRAMEPROFILER_H_
+#define _FRAMEPROFILER_H_
+
+#include <atomic>
+#include <vector>
+
+// the parts of a frame that are timed. The broadphase, narrowphase,
+// solver and integration times are parts of the step, and come from
+// Bullet's own profile zones
+enum ProfilePhase {
+	PHASE_STEP,					// stepSimulation()
+	PHASE_BROADPHASE,			// updating bounds and finding overlapping pairs
+	PHASE_NARROWPHASE,			// building contacts for the overlapping pairs
+	PHASE_SOLVER,				// solving contacts and constraints
+	PHASE_INTEGRATE,			// moving the bodies
+	PHASE_COLLISION_EVENTS,		// CheckForCollisionEvents()
+	PHASE_CAMERA,				// UpdateCamera()
+	PHASE_RENDER,				// RenderScene()
+	PHASE_SWAP,					// glutSwapBuffers()
+	PHASE_FRAME,				// the whole frame, from one EndFrame() to the next
+	NUM_PROFILE_PHASES
+};
+
+// one frame's times, in milliseconds
+struct ProfileFrame {
+	float ms[NUM_PROFILE_PHASES];
+};
+
+// times the phases of every frame and keeps the most recent ones in a
+// fixed size ring, so profiling a long run uses no more memory than a
+// short one. Phases are timed with ProfileScope, from any thread, and
+// add into the current frame until EndFrame() closes it. While the
+// profiler is off a scope costs one relaxed load and a branch, and
+// until it is first turned on Bullet's profile zones aren't hooked
+class FrameProfiler {
+public:
+	FrameProfiler(int capacity = 600);
+	~FrameProfiler();
+
+	// turning the profiler on the first time hooks Bullet's profile
+	// zones. The hooks stay in afterwards, since a zone can be open on
+	// the physics thread at any moment and must be left through the same
+	// hook it was entered through. Bullet built with BT_NO_PROFILE has
+	// no zones, so its phases stay at zero
+	void SetEnabled(bool enabled);
+	bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+	// add time to a phase of the current frame
+	void Add(ProfilePhase phase, unsigned long long microseconds) {
+		m_current[phase].fetch_add(microseconds, std::memory_order_relaxed);
+	}
+
+	// close the current frame and store it in the ring. Called once a
+	// frame, from the thread that draws
+	void EndFrame();
+
+	// the frames held, oldest first
+	int GetNumFrames() const { return m_count; }
+	const ProfileFrame& GetFrame(int i) const;
+
+	// the average of each phase over the last count frames
+	void GetAverage(int count, ProfileFrame &average) const;
+
+	static const char* GetPhaseName(ProfilePhase phase);
+
+	// write the frames held, oldest first. Return false if the file
+	// can't be written
+	bool ExportCsv(const char* path) const;
+	bool ExportJson(const char* path) const;
+
+	// a steady clock, in microseconds
+	static unsigned long long Now();
+
+private:
+	std::atomic<bool> m_enabled;
+	bool m_hooked;
+	std::atomic<unsigned long long> m_current[NUM_PROFILE_PHASES];
+	unsigned long long m_frameStart;
+
+	// the ring of finished frames
+	std::vector<ProfileFrame> m_frames;
+	int m_next;
+	int m_count;
+};
+
+// the profiler everything reports to
+extern FrameProfiler g_profiler;
+
+// times the rest of the enclosing block as one phase
+class ProfileScope {
+public:
+	ProfileScope(ProfilePhase phase)
+	:
+	m_phase(phase),
+	m_start(g_profiler.IsEnabled() ? FrameProfiler::Now() : 0)
+	{
+	}
+
+	~ProfileScope() {
+		if (m_start)
+			g_profiler.Add(m_phase, FrameProfiler::Now() - m_start);
+	}
+
+private:
+	ProfilePhase m_phase;
+	unsigned long long m_start;
+};
+
+#define PROFILE_JOIN(a, b) a##b
+#define PROFILE_NAME(line) PROFILE_JOIN(profileScope, line)
+#define PROFILE_PHASE(phase) ProfileScope PROFILE_NAME(__LINE__)(phase)
+
+#endif
@@ -15,6 +15,9 @@ static void KeyboardCallback(unsigned char key, int x, int y) {
 static void IdleCallback() {
 	g_pApp->Idle();
 }
+static void ReshapeCallback(int width, int height) {
+	g_pApp->Reshape(width, height);
+}
 
 // our custom-built 'main' function, which accepts a reference to a 
 // BulletOpenGLApplication object.
@@ -37,6 +40,11 @@ int glutmain(int argc, char **argv, int width, int height, const char* title, Bu
 	// give our static
 	glutKeyboardFunc(KeyboardCallback);
 	glutIdleFunc(IdleCallback);
+	glutReshapeFunc(ReshapeCallback);
+
+	// the window already has its size, so don't wait for the first
+	// reshape to set the camera up
+	g_pApp->Reshape(width, height);
 
 	// perform one render before we launch the application
 	g_pApp->Idle();
@@ -0,0 +1,98 @@
+#include "FrustumCuller.h"
+
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+
+void ViewFrustum::Set(const btVector3 &position, const btVector3 &target, const btVector3 &up,
+	btScalar tanHalfWidth, btScalar tanHalfHeight, btScalar nearPlane, btScalar farPlane) {
+	// the camera's own axes
+	btVector3 forward = (target - position).normalized();
+	btVector3 right = forward.cross(up).normalized();
+	btVector3 cameraUp = right.cross(forward);
+
+	// near and far face along the view direction
+	normals[0] = forward;
+	offsets[0] = -forward.dot(position + forward * nearPlane);
+	normals[1] = -forward;
+	offsets[1] = forward.dot(position + forward * farPlane);
+
+	// the four sides each contain the camera position and one edge
+	// of the view. Their normals are flipped if need be so they face
+	// the middle of the view, which is straight ahead
+	btVector3 edges[4] = {
+		forward + right * tanHalfWidth,
+		forward - right * tanHalfWidth,
+		forward + cameraUp * tanHalfHeight,
+		forward - cameraUp * tanHalfHeight
+	};
+	btVector3 across[4] = { cameraUp, cameraUp, right, right };
+
+	for (int i = 0; i < 4; i++) {
+		btVector3 normal = edges[i].cross(across[i]).normalized();
+		if (normal.dot(forward) < 0)
+			normal = -normal;
+
+		normals[2 + i] = normal;
+		offsets[2 + i] = -normal.dot(position);
+	}
+}
+
+bool ViewFrustum::Intersects(const btVector3 &aabbMin, const btVector3 &aabbMax) const {
+	for (int i = 0; i < NUM_PLANES; i++) {
+		// the corner of the box furthest along the plane's normal
+		const btVector3 &n = normals[i];
+		btVector3 corner(n.x() >= 0 ? aabbMax.x() : aabbMin.x(),
+			n.y() >= 0 ? aabbMax.y() : aabbMin.y(),
+			n.z() >= 0 ? aabbMax.z() : aabbMin.z());
+
+		// if even that is outside, the whole box is
+		if (n.dot(corner) + offsets[i] < 0)
+			return false;
+	}
+	return true;
+}
+
+// collects the entity behind every broadphase leaf btDbvt hands us
+struct CollectVisible : public btDbvt::ICollide {
+	const EntityStore &entities;
+	std::vector<const Entity*> &visible;
+
+	CollectVisible(const EntityStore &entities, std::vector<const Entity*> &visible) : entities(entities), visible(visible) {}
+
+	virtual void Process(const btDbvtNode* pLeaf) {
+		const btDbvtProxy* pProxy = static_cast<const btDbvtProxy*>(pLeaf->data);
+		const btCollisionObject* pObject = static_cast<const btCollisionObject*>(pProxy->m_clientObject);
+
+		// every body in the world came from the entity store, so the
+		// handle in its user pointer leads straight to the entity
+		const Entity* pEntity = entities.FromBody(pObject);
+		if (pEntity)
+			visible.push_back(pEntity);
+	}
+};
+
+void FrustumCuller::Cull(btBroadphaseInterface* pBroadphase, const ViewFrustum &frustum, const EntityStore &entities, std::vector<const Entity*> &visible) {
+	visible.clear();
+
+	btDbvtBroadphase* pDbvt = dynamic_cast<btDbvtBroadphase*>(pBroadphase);
+	if (pDbvt) {
+		// bodies that are moving live in the first tree and
+		// ones that have settled in the second, so search both
+		CollectVisible collect(entities, visible);
+		for (int i = 0; i < 2; i++) {
+			if (pDbvt->m_sets[i].m_root)
+				btDbvt::collideKDOP(pDbvt->m_sets[i].m_root, frustum.normals, frustum.offsets, ViewFrustum::NUM_PLANES, collect);
+		}
+	} else {
+		// no tree to search, so test each body's bounds in turn
+		for (int i = 0; i < entities.GetNumEntities(); i++) {
+			const Entity &entity = entities.GetEntity(i);
+			btVector3 aabbMin, aabbMax;
+			entity.pBody->getAabb(aabbMin, aabbMax);
+			if (frustum.Intersects(aabbMin, aabbMax))
+				visible.push_back(&entity);
+		}
+	}
+
+	m_stats.visible = (int)visible.size();
+	m_stats.culled = entities.GetNumEntities() - m_stats.visible;
+}
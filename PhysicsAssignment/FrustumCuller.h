@@ -0,0 +1,64 @@
+#ifndef _FRUSTUMCULLER_H_
+#define _FRUSTUMCULLER_H_
+
+#include "btBulletDynamicsCommon.h"
+
+#include "EntityStore.h"
+
+#include <vector>
+
+// the six planes bounding what the camera can see. Every plane's normal
+// points into the frustum, so a point p is inside a plane when
+// normals[i].dot(p) + offsets[i] >= 0, which is how btDbvt tests them
+struct ViewFrustum {
+	enum {
+		NUM_PLANES = 6
+	};
+
+	btVector3 normals[NUM_PLANES];
+	btScalar offsets[NUM_PLANES];
+
+	// until Set() is called every plane is degenerate and lets everything through
+	ViewFrustum() {
+		for (int i = 0; i < NUM_PLANES; i++) {
+			normals[i].setValue(0, 0, 0);
+			offsets[i] = 0;
+		}
+	}
+
+	// build the frustum of a camera at position looking at target.
+	// tanHalfWidth and tanHalfHeight are the tangents of half the field
+	// of view across and up, as passed to glFrustum() divided by near
+	void Set(const btVector3 &position, const btVector3 &target, const btVector3 &up,
+		btScalar tanHalfWidth, btScalar tanHalfHeight, btScalar nearPlane, btScalar farPlane);
+
+	// whether any part of the box could be on screen
+	bool Intersects(const btVector3 &aabbMin, const btVector3 &aabbMax) const;
+};
+
+// how much the last Cull() threw away
+struct CullStats {
+	int visible;
+	int culled;
+
+	CullStats() : visible(0), culled(0) {}
+};
+
+// finds the entities inside a frustum. With a btDbvtBroadphase it walks
+// the broadphase's own trees, so whole branches of off-screen bodies are
+// rejected with a single box test and the bodies inside them are never
+// touched. Any other broadphase falls back to testing each body's bounds
+class FrustumCuller {
+public:
+	// fill visible with the entities that might be on screen, in no
+	// particular order. The pointers last until an entity is created
+	// or destroyed
+	void Cull(btBroadphaseInterface* pBroadphase, const ViewFrustum &frustum, const EntityStore &entities, std::vector<const Entity*> &visible);
+
+	const CullStats& GetStats() const { return m_stats; }
+
+private:
+	CullStats m_stats;
+};
+
+#endif
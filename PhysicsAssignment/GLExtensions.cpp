@@ -0,0 +1,95 @@
+#include "GLExtensions.h"
+
+PFN_GLGENBUFFERS pglGenBuffers = 0;
+PFN_GLDELETEBUFFERS pglDeleteBuffers = 0;
+PFN_GLBINDBUFFER pglBindBuffer = 0;
+PFN_GLBUFFERDATA pglBufferData = 0;
+PFN_GLBUFFERSUBDATA pglBufferSubData = 0;
+PFN_GLMAPBUFFER pglMapBuffer = 0;
+PFN_GLUNMAPBUFFER pglUnmapBuffer = 0;
+
+PFN_GLCREATESHADER pglCreateShader = 0;
+PFN_GLDELETESHADER pglDeleteShader = 0;
+PFN_GLSHADERSOURCE pglShaderSource = 0;
+PFN_GLCOMPILESHADER pglCompileShader = 0;
+PFN_GLGETSHADERIV pglGetShaderiv = 0;
+PFN_GLGETSHADERINFOLOG pglGetShaderInfoLog = 0;
+PFN_GLCREATEPROGRAM pglCreateProgram = 0;
+PFN_GLDELETEPROGRAM pglDeleteProgram = 0;
+PFN_GLATTACHSHADER pglAttachShader = 0;
+PFN_GLLINKPROGRAM pglLinkProgram = 0;
+PFN_GLGETPROGRAMIV pglGetProgramiv = 0;
+PFN_GLUSEPROGRAM pglUseProgram = 0;
+PFN_GLGETATTRIBLOCATION pglGetAttribLocation = 0;
+PFN_GLBINDATTRIBLOCATION pglBindAttribLocation = 0;
+PFN_GLENABLEVERTEXATTRIBARRAY pglEnableVertexAttribArray = 0;
+PFN_GLDISABLEVERTEXATTRIBARRAY pglDisableVertexAttribArray = 0;
+PFN_GLVERTEXATTRIBPOINTER pglVertexAttribPointer = 0;
+
+PFN_GLVERTEXATTRIBDIVISOR pglVertexAttribDivisor = 0;
+PFN_GLDRAWARRAYSINSTANCED pglDrawArraysInstanced = 0;
+
+static void* GlutGetProc(const char* name) {
+	return (void*)glutGetProcAddress(name);
+}
+
+static GLProcLoader s_loader = GlutGetProc;
+
+void SetGLProcLoader(GLProcLoader loader) {
+	s_loader = loader ? loader : GlutGetProc;
+}
+
+// look up the core name first, then fall back to the ARB extension's
+static void* GetProc(const char* name, const char* arbName = 0) {
+	void* proc = s_loader(name);
+	if (!proc && arbName)
+		proc = s_loader(arbName);
+	return proc;
+}
+
+void LoadGLExtensions() {
+	pglGenBuffers = (PFN_GLGENBUFFERS)GetProc("glGenBuffers", "glGenBuffersARB");
+	pglDeleteBuffers = (PFN_GLDELETEBUFFERS)GetProc("glDeleteBuffers", "glDeleteBuffersARB");
+	pglBindBuffer = (PFN_GLBINDBUFFER)GetProc("glBindBuffer", "glBindBufferARB");
+	pglBufferData = (PFN_GLBUFFERDATA)GetProc("glBufferData", "glBufferDataARB");
+	pglBufferSubData = (PFN_GLBUFFERSUBDATA)GetProc("glBufferSubData", "glBufferSubDataARB");
+	pglMapBuffer = (PFN_GLMAPBUFFER)GetProc("glMapBuffer", "glMapBufferARB");
+	pglUnmapBuffer = (PFN_GLUNMAPBUFFER)GetProc("glUnmapBuffer", "glUnmapBufferARB");
+
+	pglCreateShader = (PFN_GLCREATESHADER)GetProc("glCreateShader");
+	pglDeleteShader = (PFN_GLDELETESHADER)GetProc("glDeleteShader");
+	pglShaderSource = (PFN_GLSHADERSOURCE)GetProc("glShaderSource");
+	pglCompileShader = (PFN_GLCOMPILESHADER)GetProc("glCompileShader");
+	pglGetShaderiv = (PFN_GLGETSHADERIV)GetProc("glGetShaderiv");
+	pglGetShaderInfoLog = (PFN_GLGETSHADERINFOLOG)GetProc("glGetShaderInfoLog");
+	pglCreateProgram = (PFN_GLCREATEPROGRAM)GetProc("glCreateProgram");
+	pglDeleteProgram = (PFN_GLDELETEPROGRAM)GetProc("glDeleteProgram");
+	pglAttachShader = (PFN_GLATTACHSHADER)GetProc("glAttachShader");
+	pglLinkProgram = (PFN_GLLINKPROGRAM)GetProc("glLinkProgram");
+	pglGetProgramiv = (PFN_GLGETPROGRAMIV)GetProc("glGetProgramiv");
+	pglUseProgram = (PFN_GLUSEPROGRAM)GetProc("glUseProgram");
+	pglGetAttribLocation = (PFN_GLGETATTRIBLOCATION)GetProc("glGetAttribLocation");
+	pglBindAttribLocation = (PFN_GLBINDATTRIBLOCATION)GetProc("glBindAttribLocation");
+	pglEnableVertexAttribArray = (PFN_GLENABLEVERTEXATTRIBARRAY)GetProc("glEnableVertexAttribArray");
+	pglDisableVertexAttribArray = (PFN_GLDISABLEVERTEXATTRIBARRAY)GetProc("glDisableVertexAttribArray");
+	pglVertexAttribPointer = (PFN_GLVERTEXATTRIBPOINTER)GetProc("glVertexAttribPointer");
+
+	pglVertexAttribDivisor = (PFN_GLVERTEXATTRIBDIVISOR)GetProc("glVertexAttribDivisor", "glVertexAttribDivisorARB");
+	pglDrawArraysInstanced = (PFN_GLDRAWARRAYSINSTANCED)GetProc("glDrawArraysInstanced", "glDrawArraysInstancedARB");
+}
+
+bool HasBufferObjects() {
+	return pglGenBuffers && pglDeleteBuffers && pglBindBuffer && pglBufferData && pglBufferSubData;
+}
+
+bool HasShaders() {
+	return pglCreateShader && pglDeleteShader && pglShaderSource && pglCompileShader &&
+		pglGetShaderiv && pglGetShaderInfoLog && pglCreateProgram && pglDeleteProgram &&
+		pglAttachShader && pglLinkProgram && pglGetProgramiv && pglUseProgram &&
+		pglGetAttribLocation && pglBindAttribLocation && pglEnableVertexAttribArray && pglDisableVertexAttribArray &&
+		pglVertexAttribPointer;
+}
+
+bool HasInstancing() {
+	return HasBufferObjects() && HasShaders() && pglVertexAttribDivisor && pglDrawArraysInstanced;
+}
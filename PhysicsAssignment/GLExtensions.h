@@ -0,0 +1,129 @@
+#ifndef _GLEXTENSIONS_H_
+#define _GLEXTENSIONS_H_
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+#include <GL/GL.h>
+#include <GL/freeglut.h>
+
+#include <cstddef>
+
+// the Windows OpenGL headers stop at version 1.1, so everything newer
+// (buffers, shaders, instancing) has to be fetched from the driver at
+// runtime. These are the entry points and enums the renderers use
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW 0x88E4
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_READ_ONLY
+#define GL_READ_ONLY 0x88B8
+#endif
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+#ifndef GL_VERTEX_SHADER
+#define GL_VERTEX_SHADER 0x8B31
+#endif
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#endif
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS 0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS 0x8B82
+#endif
+
+typedef void (APIENTRY *PFN_GLGENBUFFERS)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY *PFN_GLDELETEBUFFERS)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY *PFN_GLBINDBUFFER)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *PFN_GLBUFFERDATA)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+typedef void (APIENTRY *PFN_GLBUFFERSUBDATA)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const void* data);
+typedef void* (APIENTRY *PFN_GLMAPBUFFER)(GLenum target, GLenum access);
+typedef GLboolean (APIENTRY *PFN_GLUNMAPBUFFER)(GLenum target);
+
+typedef GLuint (APIENTRY *PFN_GLCREATESHADER)(GLenum type);
+typedef void (APIENTRY *PFN_GLDELETESHADER)(GLuint shader);
+typedef void (APIENTRY *PFN_GLSHADERSOURCE)(GLuint shader, GLsizei count, const char* const* source, const GLint* length);
+typedef void (APIENTRY *PFN_GLCOMPILESHADER)(GLuint shader);
+typedef void (APIENTRY *PFN_GLGETSHADERIV)(GLuint shader, GLenum pname, GLint* params);
+typedef void (APIENTRY *PFN_GLGETSHADERINFOLOG)(GLuint shader, GLsizei bufSize, GLsizei* length, char* infoLog);
+typedef GLuint (APIENTRY *PFN_GLCREATEPROGRAM)();
+typedef void (APIENTRY *PFN_GLDELETEPROGRAM)(GLuint program);
+typedef void (APIENTRY *PFN_GLATTACHSHADER)(GLuint program, GLuint shader);
+typedef void (APIENTRY *PFN_GLLINKPROGRAM)(GLuint program);
+typedef void (APIENTRY *PFN_GLGETPROGRAMIV)(GLuint program, GLenum pname, GLint* params);
+typedef void (APIENTRY *PFN_GLUSEPROGRAM)(GLuint program);
+typedef GLint (APIENTRY *PFN_GLGETATTRIBLOCATION)(GLuint program, const char* name);
+typedef void (APIENTRY *PFN_GLBINDATTRIBLOCATION)(GLuint program, GLuint index, const char* name);
+
+typedef void (APIENTRY *PFN_GLENABLEVERTEXATTRIBARRAY)(GLuint index);
+typedef void (APIENTRY *PFN_GLDISABLEVERTEXATTRIBARRAY)(GLuint index);
+typedef void (APIENTRY *PFN_GLVERTEXATTRIBPOINTER)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+typedef void (APIENTRY *PFN_GLVERTEXATTRIBDIVISOR)(GLuint index, GLuint divisor);
+typedef void (APIENTRY *PFN_GLDRAWARRAYSINSTANCED)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+
+// buffer objects (OpenGL 1.5)
+extern PFN_GLGENBUFFERS pglGenBuffers;
+extern PFN_GLDELETEBUFFERS pglDeleteBuffers;
+extern PFN_GLBINDBUFFER pglBindBuffer;
+extern PFN_GLBUFFERDATA pglBufferData;
+extern PFN_GLBUFFERSUBDATA pglBufferSubData;
+extern PFN_GLMAPBUFFER pglMapBuffer;
+extern PFN_GLUNMAPBUFFER pglUnmapBuffer;
+
+// shaders (OpenGL 2.0)
+extern PFN_GLCREATESHADER pglCreateShader;
+extern PFN_GLDELETESHADER pglDeleteShader;
+extern PFN_GLSHADERSOURCE pglShaderSource;
+extern PFN_GLCOMPILESHADER pglCompileShader;
+extern PFN_GLGETSHADERIV pglGetShaderiv;
+extern PFN_GLGETSHADERINFOLOG pglGetShaderInfoLog;
+extern PFN_GLCREATEPROGRAM pglCreateProgram;
+extern PFN_GLDELETEPROGRAM pglDeleteProgram;
+extern PFN_GLATTACHSHADER pglAttachShader;
+extern PFN_GLLINKPROGRAM pglLinkProgram;
+extern PFN_GLGETPROGRAMIV pglGetProgramiv;
+extern PFN_GLUSEPROGRAM pglUseProgram;
+extern PFN_GLGETATTRIBLOCATION pglGetAttribLocation;
+extern PFN_GLBINDATTRIBLOCATION pglBindAttribLocation;
+extern PFN_GLENABLEVERTEXATTRIBARRAY pglEnableVertexAttribArray;
+extern PFN_GLDISABLEVERTEXATTRIBARRAY pglDisableVertexAttribArray;
+extern PFN_GLVERTEXATTRIBPOINTER pglVertexAttribPointer;
+
+// instancing (OpenGL 3.3 or ARB_instanced_arrays/ARB_draw_instanced)
+extern PFN_GLVERTEXATTRIBDIVISOR pglVertexAttribDivisor;
+extern PFN_GLDRAWARRAYSINSTANCED pglDrawArraysInstanced;
+
+// where LoadGLExtensions() looks entry points up. FreeGLUT's lookup is
+// used unless a context made without FreeGLUT supplies its own
+typedef void* (*GLProcLoader)(const char* name);
+void SetGLProcLoader(GLProcLoader loader);
+
+// fetch every entry point above. Must be called with a current GL
+// context. Safe to call more than once
+void LoadGLExtensions();
+
+// capability checks, valid after LoadGLExtensions()
+bool HasBufferObjects();
+bool HasShaders();
+bool HasInstancing();
+
+#endif
@@ -0,0 +1,166 @@
+#include "LayoutSimulation.h"
+#include "SceneSimulation.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// runs the domino scene without a window. Every step is a fixed dt,
+// so two runs with the same arguments produce the same result
+static void PrintUsage(const char* program) {
+	printf("usage: %s [--steps N] [--dt seconds] [--until-asleep] [--layout name --count N] [--scene file] [--write-scene file] [--threads N] [--record file] [--wavefront] [--broadphase dbvt|sap] [--solver fast|balanced|accurate] [--no-ccd]\n", program);
+	printf("  --steps N        maximum number of steps to run (default 600)\n");
+	printf("  --dt seconds     fixed time step (default 1/60)\n");
+	printf("  --until-asleep   stop as soon as every body has gone to sleep\n");
+	printf("  --layout name    generated layout to run instead of the demo scene (line, double, grid, spiral, curve)\n");
+	printf("  --count N        number of dominos in the generated layout (default 1000)\n");
+	printf("  --scene file     load the scene from a scene file instead\n");
+	printf("  --write-scene f  save the generated layout as a scene file and exit\n");
+	printf("  --threads N      worker threads to step the world with (default 1)\n");
+	printf("  --record file    record every step, for playback in the application\n");
+	printf("  --wavefront      only simulate the dominos near each chain's toppling front\n");
+	printf("  --broadphase b   dbvt (default) or sap, sweep and prune over the scene's bounds\n");
+	printf("  --solver p       fast, balanced (default) or accurate constraint solving\n");
+	printf("  --no-ccd         no continuous collision for thin boxes\n");
+}
+
+int main(int argc, char** argv)
+{
+	int maxSteps = 600;
+	float dt = 1.0f / 60.0f;
+	bool untilAsleep = false;
+	const char* layoutName = 0;
+	int count = 1000;
+	const char* scenePath = 0;
+	const char* writeScenePath = 0;
+	int threads = 1;
+	const char* recordPath = 0;
+	WavefrontSettings wavefront;
+	BroadphaseSettings broadphase;
+	SolverProfile solver = SOLVER_PROFILE_BALANCED;
+	CcdSettings ccd;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+			maxSteps = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--dt") == 0 && i + 1 < argc) {
+			dt = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "--until-asleep") == 0) {
+			untilAsleep = true;
+		} else if (strcmp(argv[i], "--layout") == 0 && i + 1 < argc) {
+			layoutName = argv[++i];
+		} else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+			count = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+			scenePath = argv[++i];
+		} else if (strcmp(argv[i], "--write-scene") == 0 && i + 1 < argc) {
+			writeScenePath = argv[++i];
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			recordPath = argv[++i];
+		} else if (strcmp(argv[i], "--wavefront") == 0) {
+			wavefront.enabled = true;
+		} else if (strcmp(argv[i], "--broadphase") == 0 && i + 1 < argc && ParseBroadphaseName(argv[i + 1], broadphase.type)) {
+			i++;
+		} else if (strcmp(argv[i], "--solver") == 0 && i + 1 < argc && ParseSolverProfileName(argv[i + 1], solver)) {
+			i++;
+		} else if (strcmp(argv[i], "--no-ccd") == 0) {
+			ccd.enabled = false;
+		} else {
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (maxSteps <= 0 || dt <= 0.0f || threads <= 0) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	btClock clock;
+
+	// the hand-placed demo scene, a generated one or one from a file
+	PhysicsSimulation* pSimulation = 0;
+	SceneFile scene;
+	if (layoutName) {
+		DominoLayout layout;
+		if (count < 2 || !BuildLayoutByName(layoutName, count, DOMINO_DEFAULT_SPACING, layout)) {
+			PrintUsage(argv[0]);
+			return 1;
+		}
+
+		if (writeScenePath) {
+			if (!WriteSceneFile(writeScenePath, layout)) {
+				printf("could not write scene file '%s'\n", writeScenePath);
+				return 1;
+			}
+			printf("wrote %d dominos to %s\n", (int)layout.placements.size(), writeScenePath);
+			return 0;
+		}
+		pSimulation = new LayoutSimulation(layout);
+	} else if (scenePath) {
+		if (!scene.Open(scenePath))
+			return 1;
+		if (scene.GetNumDominos() < 2) {
+			printf("scene file '%s' needs at least two dominos\n", scenePath);
+			return 1;
+		}
+		pSimulation = new SceneSimulation(scene);
+	} else if (writeScenePath) {
+		PrintUsage(argv[0]);
+		return 1;
+	} else {
+		pSimulation = new PhysicsSimulation();
+	}
+	pSimulation->SetNumThreads(threads);
+	pSimulation->SetWavefront(wavefront);
+	pSimulation->SetBroadphase(broadphase);
+	pSimulation->SetSolver(GetSolverProfile(solver));
+	pSimulation->SetCcd(ccd);
+	pSimulation->Initialize();
+	unsigned long setup = clock.getTimeMilliseconds();
+
+	TrajectoryRecorder recorder;
+	if (recordPath) {
+		if (!recorder.Open(recordPath, pSimulation->GetEntities()))
+			return 1;
+		pSimulation->SetRecorder(&recorder);
+	}
+
+	clock.reset();
+	int steps = pSimulation->RunFixedSteps(dt, maxSteps, untilAsleep);
+	unsigned long elapsed = clock.getTimeMilliseconds();
+
+	printf("setup time:      %lu ms\n", setup);
+	printf("steps:           %d\n", steps);
+	printf("simulated time:  %.3f s\n", steps * dt);
+	printf("wall time:       %lu ms\n", elapsed);
+	printf("threads:         %d\n", pSimulation->GetNumThreads());
+	printf("broadphase:      %s, %d pairs\n", GetBroadphaseName(broadphase.type), pSimulation->GetPairCache()->getNumOverlappingPairs());
+	const SolverSettings &solverSettings = pSimulation->GetSolverSettings();
+	printf("solver:          %s, %s with %d iterations\n", GetSolverProfileName(solver), GetSolverTypeName(solverSettings.type), solverSettings.iterations);
+	printf("ccd bodies:      %d\n", pSimulation->GetNumCcdBodies());
+	printf("active bodies:   %d\n", pSimulation->GetNumActiveBodies());
+	printf("sleeping bodies: %d\n", pSimulation->GetNumSleepingBodies());
+	if (wavefront.enabled) {
+		const WavefrontStats &stats = pSimulation->GetWavefront().GetStats();
+		printf("wavefront:       %d live, %d dormant, %d retired, %d woken by contact\n",
+			stats.live, stats.dormant, stats.retired, stats.contactWakes);
+	}
+
+	ShapeRegistryStats shapes = pSimulation->GetShapes().GetStats();
+	printf("shapes:          %d shared by %d bodies (%u bytes saved)\n", shapes.uniqueShapes, shapes.references, (unsigned int)shapes.bytesSaved);
+
+	if (recorder.IsOpen()) {
+		const TrajectoryStats &stats = recorder.GetStats();
+		printf("recording:       %d frames, %d keyframes, %u body records, %llu bytes\n",
+			stats.frames, stats.keyframes, stats.bodyRecords, stats.bytes);
+		pSimulation->SetRecorder(0);
+		if (!recorder.Close())
+			printf("could not finish writing the recording '%s'\n", recordPath);
+	}
+
+	delete pSimulation;
+	return 0;
+}
@@ -0,0 +1,327 @@
+#include "InstancedRenderer.h"
+
+#include <cstdio>
+
+// fixed attribute slots, bound before the shader is linked. The
+// transform is a mat4 and so takes up four consecutive slots
+#define POSITION_SLOT 0
+#define NORMAL_SLOT 1
+#define TRANSFORM_SLOT 2
+#define HALFSIZE_SLOT 6
+#define COLOR_SLOT 7
+
+// the unit box is drawn as 12 triangles
+#define BOX_VERTEX_COUNT 36
+
+// the card is the box's front and back faces, 4 triangles, and sits in
+// the same buffer straight after the box
+#define CARD_VERTEX_COUNT 12
+
+static const int s_meshFirstVertex[NUM_BOX_MESHES] = { 0, BOX_VERTEX_COUNT };
+static const int s_meshVertexCount[NUM_BOX_MESHES] = { BOX_VERTEX_COUNT, CARD_VERTEX_COUNT };
+
+// places the unit box in the world and lights it the same way the
+// fixed function pipeline lights the immediate mode boxes (LIGHT0,
+// color material and the front material's specular/shininess)
+static const char* s_vertexShader =
+	"#version 120\n"
+	"attribute vec3 a_position;\n"
+	"attribute vec3 a_normal;\n"
+	"attribute mat4 a_transform;\n"
+	"attribute vec3 a_halfSize;\n"
+	"attribute vec3 a_color;\n"
+	"varying vec4 v_color;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 world = a_transform * vec4(a_position * a_halfSize, 1.0);\n"
+	"	gl_Position = gl_ModelViewProjectionMatrix * world;\n"
+	"	vec3 normal = normalize(gl_NormalMatrix * (mat3(a_transform) * a_normal));\n"
+	"	vec3 light = normalize(gl_LightSource[0].position.xyz);\n"
+	"	float diffuse = max(dot(normal, light), 0.0);\n"
+	"	float specular = 0.0;\n"
+	"	if (diffuse > 0.0)\n"
+	"		specular = pow(max(dot(normal, normalize(gl_LightSource[0].halfVector.xyz)), 0.0), gl_FrontMaterial.shininess);\n"
+	"	vec3 lit = a_color * (gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb + gl_LightSource[0].diffuse.rgb * diffuse);\n"
+	"	lit += gl_FrontMaterial.specular.rgb * gl_LightSource[0].specular.rgb * specular;\n"
+	"	v_color = vec4(lit, 1.0);\n"
+	"}\n";
+
+static const char* s_fragmentShader =
+	"#version 120\n"
+	"varying vec4 v_color;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = v_color;\n"
+	"}\n";
+
+InstancedRenderer::InstancedRenderer()
+:
+m_available(false),
+m_program(0),
+m_meshBuffer(0),
+m_instanceBuffer(0),
+m_instanceCapacity(0),
+m_positionLocation(-1),
+m_normalLocation(-1),
+m_transformLocation(-1),
+m_halfSizeLocation(-1),
+m_colorLocation(-1),
+m_numDrawn(0),
+m_numTriangles(0)
+{
+}
+
+InstancedRenderer::~InstancedRenderer() {
+	Shutdown();
+}
+
+GLuint InstancedRenderer::CompileShader(GLenum type, const char* source) {
+	GLuint shader = pglCreateShader(type);
+	pglShaderSource(shader, 1, &source, 0);
+	pglCompileShader(shader);
+
+	GLint compiled = 0;
+	pglGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (!compiled) {
+		char log[1024];
+		pglGetShaderInfoLog(shader, sizeof(log), 0, log);
+		fprintf(stderr, "box shader failed to compile: %s\n", log);
+		pglDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+bool InstancedRenderer::Initialize() {
+	LoadGLExtensions();
+	if (!HasInstancing())
+		return false;
+
+	// build the shader program
+	GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, s_vertexShader);
+	GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, s_fragmentShader);
+	if (!vertexShader || !fragmentShader) {
+		if (vertexShader) pglDeleteShader(vertexShader);
+		if (fragmentShader) pglDeleteShader(fragmentShader);
+		return false;
+	}
+
+	m_program = pglCreateProgram();
+	pglAttachShader(m_program, vertexShader);
+	pglAttachShader(m_program, fragmentShader);
+	pglBindAttribLocation(m_program, POSITION_SLOT, "a_position");
+	pglBindAttribLocation(m_program, NORMAL_SLOT, "a_normal");
+	pglBindAttribLocation(m_program, TRANSFORM_SLOT, "a_transform");
+	pglBindAttribLocation(m_program, HALFSIZE_SLOT, "a_halfSize");
+	pglBindAttribLocation(m_program, COLOR_SLOT, "a_color");
+	pglLinkProgram(m_program);
+
+	// the program keeps the compiled code, so the shaders can go
+	pglDeleteShader(vertexShader);
+	pglDeleteShader(fragmentShader);
+
+	GLint linked = 0;
+	pglGetProgramiv(m_program, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		fprintf(stderr, "box shader failed to link\n");
+		Shutdown();
+		return false;
+	}
+
+	m_positionLocation = pglGetAttribLocation(m_program, "a_position");
+	m_normalLocation = pglGetAttribLocation(m_program, "a_normal");
+	m_transformLocation = pglGetAttribLocation(m_program, "a_transform");
+	m_halfSizeLocation = pglGetAttribLocation(m_program, "a_halfSize");
+	m_colorLocation = pglGetAttribLocation(m_program, "a_color");
+
+	// build the unit box once, with the same corners, triangles and
+	// face normals DrawBox() works out for every box on every frame
+	btVector3 vertices[8]={
+	btVector3(1,1,1),
+	btVector3(-1,1,1),
+	btVector3(1,-1,1),
+	btVector3(-1,-1,1),
+	btVector3(1,1,-1),
+	btVector3(-1,1,-1),
+	btVector3(1,-1,-1),
+	btVector3(-1,-1,-1)};
+
+	static int indices[BOX_VERTEX_COUNT] = {
+		0,1,2,
+		3,2,1,
+		4,0,6,
+		6,0,2,
+		5,1,4,
+		4,1,0,
+		7,3,1,
+		7,1,5,
+		5,4,7,
+		7,4,6,
+		7,2,3,
+		7,6,2};
+
+	// the card reuses the box's +z and -z faces, so up close it lines
+	// up exactly with the box it stands in for
+	static int cardIndices[CARD_VERTEX_COUNT] = {
+		0,1,2,
+		3,2,1,
+		5,4,7,
+		7,4,6};
+
+	// interleaved position and normal for every vertex
+	GLfloat mesh[(BOX_VERTEX_COUNT + CARD_VERTEX_COUNT) * 6];
+	for (int i = 0; i < BOX_VERTEX_COUNT + CARD_VERTEX_COUNT; i += 3) {
+		const int* source = i < BOX_VERTEX_COUNT ? &indices[i] : &cardIndices[i - BOX_VERTEX_COUNT];
+		const btVector3 &vert1 = vertices[source[0]];
+		const btVector3 &vert2 = vertices[source[1]];
+		const btVector3 &vert3 = vertices[source[2]];
+
+		btVector3 normal = (vert3-vert1).cross(vert2-vert1);
+		normal.normalize();
+
+		for (int j = 0; j < 3; j++) {
+			const btVector3 &vert = vertices[source[j]];
+			GLfloat* out = &mesh[(i+j) * 6];
+			out[0] = vert.x(); out[1] = vert.y(); out[2] = vert.z();
+			out[3] = normal.x(); out[4] = normal.y(); out[5] = normal.z();
+		}
+	}
+
+	pglGenBuffers(1, &m_meshBuffer);
+	pglBindBuffer(GL_ARRAY_BUFFER, m_meshBuffer);
+	pglBufferData(GL_ARRAY_BUFFER, sizeof(mesh), mesh, GL_STATIC_DRAW);
+
+	pglGenBuffers(1, &m_instanceBuffer);
+	pglBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_available = true;
+	return true;
+}
+
+void InstancedRenderer::Shutdown() {
+	if (m_program)
+		pglDeleteProgram(m_program);
+	if (m_meshBuffer)
+		pglDeleteBuffers(1, &m_meshBuffer);
+	if (m_instanceBuffer)
+		pglDeleteBuffers(1, &m_instanceBuffer);
+
+	m_program = 0;
+	m_meshBuffer = 0;
+	m_instanceBuffer = 0;
+	m_instanceCapacity = 0;
+	m_available = false;
+}
+
+void InstancedRenderer::Begin() {
+	// keep the vectors' memory around from frame to frame
+	for (int i = 0; i < NUM_BOX_MESHES; i++)
+		m_instances[i].clear();
+}
+
+int InstancedRenderer::GetMeshTriangles(BoxMesh mesh) {
+	return s_meshVertexCount[mesh] / 3;
+}
+
+void InstancedRenderer::AddBox(const btScalar* transform, const btVector3 &halfSize, const btVector3 &color, BoxMesh mesh) {
+	if (mesh == BOX_MESH_CARD && halfSize.minAxis() != 2)
+		mesh = BOX_MESH_FULL;
+
+	std::vector<BoxInstance> &instances = m_instances[mesh];
+	instances.push_back(BoxInstance());
+	BoxInstance &instance = instances.back();
+
+	for (int i = 0; i < 16; i++)
+		instance.transform[i] = transform[i];
+
+	instance.halfSize[0] = halfSize.x();
+	instance.halfSize[1] = halfSize.y();
+	instance.halfSize[2] = halfSize.z();
+
+	instance.color[0] = color.x();
+	instance.color[1] = color.y();
+	instance.color[2] = color.z();
+}
+
+void InstancedRenderer::Flush() {
+	m_numDrawn = 0;
+	m_numTriangles = 0;
+
+	int count = 0;
+	for (int i = 0; i < NUM_BOX_MESHES; i++)
+		count += (int)m_instances[i].size();
+	if (!m_available || count == 0)
+		return;
+
+	// upload the frame's instances in one go, each mesh's boxes after
+	// the last's. Re-specifying the buffer each frame lets the driver
+	// hand us fresh memory rather than wait for the GPU to finish with
+	// last frame's copy
+	pglBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	if (count > m_instanceCapacity)
+		m_instanceCapacity = count + count / 2;
+	pglBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(BoxInstance), 0, GL_STREAM_DRAW);
+	int uploaded = 0;
+	for (int i = 0; i < NUM_BOX_MESHES; i++) {
+		if (m_instances[i].empty())
+			continue;
+		pglBufferSubData(GL_ARRAY_BUFFER, uploaded * sizeof(BoxInstance), m_instances[i].size() * sizeof(BoxInstance), &m_instances[i][0]);
+		uploaded += (int)m_instances[i].size();
+	}
+
+	pglUseProgram(m_program);
+
+	// per-vertex attributes from the unit box and card
+	pglBindBuffer(GL_ARRAY_BUFFER, m_meshBuffer);
+	pglEnableVertexAttribArray(m_positionLocation);
+	pglVertexAttribPointer(m_positionLocation, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (const void*)0);
+	pglEnableVertexAttribArray(m_normalLocation);
+	pglVertexAttribPointer(m_normalLocation, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (const void*)(3 * sizeof(GLfloat)));
+
+	// per-instance attributes, stepping once per box
+	pglBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	for (int column = 0; column < 4; column++) {
+		pglEnableVertexAttribArray(m_transformLocation + column);
+		pglVertexAttribDivisor(m_transformLocation + column, 1);
+	}
+	pglEnableVertexAttribArray(m_halfSizeLocation);
+	pglVertexAttribDivisor(m_halfSizeLocation, 1);
+	pglEnableVertexAttribArray(m_colorLocation);
+	pglVertexAttribDivisor(m_colorLocation, 1);
+
+	// one draw per mesh, with the instance attributes pointed at that
+	// mesh's part of the buffer
+	GLsizei stride = sizeof(BoxInstance);
+	int first = 0;
+	for (int i = 0; i < NUM_BOX_MESHES; i++) {
+		int instances = (int)m_instances[i].size();
+		if (instances == 0)
+			continue;
+
+		size_t base = first * sizeof(BoxInstance);
+		for (int column = 0; column < 4; column++)
+			pglVertexAttribPointer(m_transformLocation + column, 4, GL_FLOAT, GL_FALSE, stride, (const void*)(base + offsetof(BoxInstance, transform) + column * 4 * sizeof(GLfloat)));
+		pglVertexAttribPointer(m_halfSizeLocation, 3, GL_FLOAT, GL_FALSE, stride, (const void*)(base + offsetof(BoxInstance, halfSize)));
+		pglVertexAttribPointer(m_colorLocation, 3, GL_FLOAT, GL_FALSE, stride, (const void*)(base + offsetof(BoxInstance, color)));
+
+		pglDrawArraysInstanced(GL_TRIANGLES, s_meshFirstVertex[i], s_meshVertexCount[i], instances);
+		m_numTriangles += instances * GetMeshTriangles((BoxMesh)i);
+		first += instances;
+	}
+	m_numDrawn = count;
+
+	// put everything back so the immediate mode path is unaffected
+	for (int column = 0; column < 4; column++) {
+		pglVertexAttribDivisor(m_transformLocation + column, 0);
+		pglDisableVertexAttribArray(m_transformLocation + column);
+	}
+	pglVertexAttribDivisor(m_halfSizeLocation, 0);
+	pglDisableVertexAttribArray(m_halfSizeLocation);
+	pglVertexAttribDivisor(m_colorLocation, 0);
+	pglDisableVertexAttribArray(m_colorLocation);
+	pglDisableVertexAttribArray(m_positionLocation);
+	pglDisableVertexAttribArray(m_normalLocation);
+
+	pglBindBuffer(GL_ARRAY_BUFFER, 0);
+	pglUseProgram(0);
+}
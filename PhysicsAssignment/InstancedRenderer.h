@@ -0,0 +1,87 @@
+#ifndef _INSTANCEDRENDERER_H_
+#define _INSTANCEDRENDERER_H_
+
+#include "GLExtensions.h"
+
+#include "btBulletDynamicsCommon.h"
+#include <vector>
+
+// everything the box shader needs to know about one box. The
+// transform is the body's OpenGL matrix, without any scaling
+struct BoxInstance {
+	GLfloat transform[16];
+	GLfloat halfSize[3];
+	GLfloat color[3];
+};
+
+// the meshes a box can be drawn with
+enum BoxMesh {
+	BOX_MESH_FULL,	// all six faces, 12 triangles
+	BOX_MESH_CARD,	// just the two faces either side of z, 4 triangles
+	NUM_BOX_MESHES
+};
+
+// draws every box in the scene with a single instanced draw call.
+
+// A unit box is uploaded once at startup, and each frame the boxes'
+// transforms and colors are gathered into one buffer and handed over
+// in a single upload, instead of 36 glVertex3f calls per box
+class InstancedRenderer {
+public:
+	InstancedRenderer();
+	~InstancedRenderer();
+
+	// compiles the shader and uploads the unit box. Returns false if the
+	// driver can't do instancing, in which case the caller should stick
+	// to immediate mode drawing
+	bool Initialize();
+	bool IsAvailable() const { return m_available; }
+
+	// start collecting a new frame's boxes
+	void Begin();
+
+	// queue a box for this frame. A card only looks like the box from a
+	// distance, and only when z is the box's thinnest side, as it is
+	// for a domino, so anything else is drawn whole
+	void AddBox(const btScalar* transform, const btVector3 &halfSize, const btVector3 &color, BoxMesh mesh = BOX_MESH_FULL);
+
+	// upload the queued boxes and draw them all, one draw call per mesh
+	void Flush();
+
+	// number of boxes drawn by the last Flush()
+	int GetNumDrawn() const { return m_numDrawn; }
+
+	// number of triangles drawn by the last Flush()
+	int GetNumTriangles() const { return m_numTriangles; }
+
+	// triangles in each mesh
+	static int GetMeshTriangles(BoxMesh mesh);
+
+private:
+	void Shutdown();
+	GLuint CompileShader(GLenum type, const char* source);
+
+	bool m_available;
+
+	GLuint m_program;
+	GLuint m_meshBuffer;
+	GLuint m_instanceBuffer;
+
+	// capacity of m_instanceBuffer in instances
+	int m_instanceCapacity;
+
+	// attribute locations in the box shader
+	GLint m_positionLocation;
+	GLint m_normalLocation;
+	GLint m_transformLocation;
+	GLint m_halfSizeLocation;
+	GLint m_colorLocation;
+
+	// the boxes gathered since Begin(), one list per mesh
+	std::vector<BoxInstance> m_instances[NUM_BOX_MESHES];
+
+	int m_numDrawn;
+	int m_numTriangles;
+};
+
+#endif
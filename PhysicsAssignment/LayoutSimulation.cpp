@@ -0,0 +1,35 @@
+#include "LayoutSimulation.h"
+
+LayoutSimulation::LayoutSimulation(const DominoLayout &layout)
+:
+m_layout(layout)
+{
+	// every chain gets pushed, not just the first
+	m_leads = m_layout.leads;
+}
+
+void LayoutSimulation::CreateGround() {
+	btVector3 centre, halfExtents;
+	m_layout.GetGround(centre, halfExtents);
+
+	CreateGameObject(m_shapes.AcquireBox(halfExtents), 0, btVector3(0.2f, 0.6f, 0.6f), centre);
+}
+
+void LayoutSimulation::CreateObjects() {
+	// size the pools for the whole layout up front
+	dominos.reserve(m_layout.placements.size());
+	ReserveEntities((int)m_layout.placements.size());
+
+	for (int i = 0; i < m_layout.placements.size(); i++) {
+		const DominoPlacement &placement = m_layout.placements[i];
+		CreateDomino(placement.position, placement.orientation);
+	}
+}
+
+void LayoutSimulation::GetSceneBounds(btVector3 &boundsMin, btVector3 &boundsMax) const {
+	// from the ground up to the tops of the standing dominos
+	boundsMin = m_layout.boundsMin;
+	boundsMax = m_layout.boundsMax;
+	boundsMin.setY(-1.0f);
+	boundsMax.setY(boundsMax.y() + DOMINO_STANDING_HEIGHT);
+}
@@ -0,0 +1,26 @@
+#ifndef _LAYOUTSIMULATION_H_
+#define _LAYOUTSIMULATION_H_
+
+#include "PhysicsSimulation.h"
+#include "DominoLayout.h"
+
+// a simulation whose scene comes from a generated DominoLayout instead
+// of the hand-placed demo. The ground is sized to fit the layout and
+// every chain's lead domino is pushed until the first one hits its neighbour
+class LayoutSimulation : public PhysicsSimulation {
+public:
+	LayoutSimulation(const DominoLayout &layout);
+
+	virtual void CreateGround();
+	virtual void CreateObjects();
+
+	virtual void GetSceneBounds(btVector3 &boundsMin, btVector3 &boundsMax) const;
+	virtual int GetExpectedBodies() const { return (int)m_layout.placements.size() + 1; }
+
+	const DominoLayout& GetLayout() const { return m_layout; }
+
+protected:
+	DominoLayout m_layout;
+};
+
+#endif
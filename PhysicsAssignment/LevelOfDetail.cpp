@@ -0,0 +1,61 @@
+#include "LevelOfDetail.h"
+
+// the smallest projected diameter, in pixels, each level is used at
+static const btScalar LOD_THRESHOLDS[LOD_HIDDEN] = { 96.0f, 24.0f, 6.0f, 0.75f };
+
+// cylinder tessellation per level. Full is what DrawCylinder always used
+static const int CYLINDER_SLICES[NUM_LOD_LEVELS] = { 15, 10, 6, 6, 0 };
+static const int CYLINDER_STACKS[NUM_LOD_LEVELS] = { 10, 4, 1, 1, 0 };
+
+LodSelector::LodSelector()
+:
+m_cameraPosition(0,0,0),
+m_scale2(0),
+m_pixelsPerUnit(0),
+m_quality(1.0f)
+{
+}
+
+void LodSelector::SetView(const btVector3 &cameraPosition, int screenHeight, btScalar tanHalfFovY) {
+	m_cameraPosition = cameraPosition;
+	// a sphere of radius r at distance d covers r / (d * tan) of half
+	// the screen, so its diameter in pixels is r * height / (d * tan)
+	m_pixelsPerUnit = screenHeight / tanHalfFovY;
+	m_scale2 = m_pixelsPerUnit * m_quality * m_pixelsPerUnit * m_quality;
+}
+
+void LodSelector::SetQuality(btScalar quality) {
+	m_quality = quality;
+	m_scale2 = m_pixelsPerUnit * m_quality * m_pixelsPerUnit * m_quality;
+}
+
+LodLevel LodSelector::Select(const btVector3 &centre, btScalar radius) const {
+	btScalar distance2 = centre.distance2(m_cameraPosition);
+	btScalar size2 = radius * radius * m_scale2;
+
+	// the camera is inside the sphere
+	if (distance2 <= radius * radius)
+		return LOD_FULL;
+
+	// size / distance >= threshold, without the square roots
+	for (int level = 0; level < LOD_HIDDEN; level++) {
+		if (size2 >= LOD_THRESHOLDS[level] * LOD_THRESHOLDS[level] * distance2)
+			return (LodLevel)level;
+	}
+	return LOD_HIDDEN;
+}
+
+btScalar LodSelector::GetProjectedSize(const btVector3 &centre, btScalar radius) const {
+	btScalar distance = centre.distance(m_cameraPosition);
+	if (distance <= radius)
+		return BT_LARGE_FLOAT;
+	return radius * m_pixelsPerUnit / distance;
+}
+
+int LodSelector::GetCylinderSlices(LodLevel level) {
+	return CYLINDER_SLICES[level];
+}
+
+int LodSelector::GetCylinderStacks(LodLevel level) {
+	return CYLINDER_STACKS[level];
+}
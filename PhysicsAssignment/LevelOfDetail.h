@@ -0,0 +1,65 @@
+#ifndef _LEVELOFDETAIL_H_
+#define _LEVELOFDETAIL_H_
+
+#include "btBulletDynamicsCommon.h"
+
+// how much detail to draw a shape with, from most to least
+enum LodLevel {
+	LOD_FULL,
+	LOD_MEDIUM,
+	LOD_LOW,
+	LOD_IMPOSTOR,	// a flat stand-in, for shapes a few pixels across
+	LOD_HIDDEN,		// smaller than a pixel, so not drawn at all
+	NUM_LOD_LEVELS
+};
+
+// what a frame's drawing cost
+struct LodStats {
+	int triangles;
+	int objects[NUM_LOD_LEVELS];
+
+	LodStats() { Reset(); }
+	void Reset() {
+		triangles = 0;
+		for (int i = 0; i < NUM_LOD_LEVELS; i++)
+			objects[i] = 0;
+	}
+};
+
+// picks a level of detail from how big a shape's bounding sphere looks
+// on screen. The quality setting scales the projected size before it is
+// compared against the thresholds, so below 1 detail drops off sooner,
+// trading looks for frame time, and above 1 it drops off later
+class LodSelector {
+public:
+	LodSelector();
+
+	// the camera to measure from. tanHalfFovY is the tangent of half
+	// the vertical field of view
+	void SetView(const btVector3 &cameraPosition, int screenHeight, btScalar tanHalfFovY);
+
+	void SetQuality(btScalar quality);
+	btScalar GetQuality() const { return m_quality; }
+
+	// the level to draw a shape of the given bounding radius at centre with
+	LodLevel Select(const btVector3 &centre, btScalar radius) const;
+
+	// the diameter, in pixels, the sphere covers on screen
+	btScalar GetProjectedSize(const btVector3 &centre, btScalar radius) const;
+
+	// cylinder tessellation for each level
+	static int GetCylinderSlices(LodLevel level);
+	static int GetCylinderStacks(LodLevel level);
+
+private:
+	btVector3 m_cameraPosition;
+
+	// screen height over tan(fov / 2), times quality, squared. The
+	// projected size is radius times this over distance, so comparing
+	// squares saves a square root per shape
+	btScalar m_scale2;
+	btScalar m_pixelsPerUnit;
+	btScalar m_quality;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+:
+#ifdef _WIN32
+m_file(INVALID_HANDLE_VALUE),
+m_mapping(0),
+#else
+m_file(-1),
+#endif
+m_pData(0),
+m_size(0)
+{
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(const char* path) {
+	Close();
+
+#ifdef _WIN32
+	// the file is read front to back, so tell the cache manager
+	m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+		Close();
+		return false;
+	}
+	m_size = (size_t)size.QuadPart;
+
+	m_mapping = CreateFileMappingA(m_file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!m_mapping) {
+		Close();
+		return false;
+	}
+
+	m_pData = static_cast<const unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_pData) {
+		Close();
+		return false;
+	}
+#else
+	m_file = open(path, O_RDONLY);
+	if (m_file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(m_file, &info) != 0 || info.st_size == 0) {
+		Close();
+		return false;
+	}
+	m_size = (size_t)info.st_size;
+
+	void* pData = mmap(0, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+	if (pData == MAP_FAILED) {
+		Close();
+		return false;
+	}
+
+	// the file is read front to back, so let the kernel read ahead
+	madvise(pData, m_size, MADV_SEQUENTIAL);
+	m_pData = static_cast<const unsigned char*>(pData);
+#endif
+
+	return true;
+}
+
+void MappedFile::Close() {
+#ifdef _WIN32
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+	m_mapping = 0;
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	if (m_pData)
+		munmap(const_cast<unsigned char*>(m_pData), m_size);
+	if (m_file >= 0)
+		close(m_file);
+	m_file = -1;
+#endif
+	m_pData = 0;
+	m_size = 0;
+}
@@ -0,0 +1,38 @@
+#ifndef _MAPPEDFILE_H_
+#define _MAPPEDFILE_H_
+
+#include <cstddef>
+
+// a read-only view of a whole file, mapped into memory. The operating
+// system pages the file in as it is read, so nothing is copied into a
+// buffer first and a big file costs no more than the pages touched
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	// map the file, closing any file already open. Returns false if
+	// the file can't be opened or is empty
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return m_pData != 0; }
+	const unsigned char* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	// not copyable, the mapping belongs to one object
+	MappedFile(const MappedFile &);
+	MappedFile& operator=(const MappedFile &);
+
+#ifdef _WIN32
+	void* m_file;		// HANDLEs, kept as void* to leave Windows.h out of the header
+	void* m_mapping;
+#else
+	int m_file;
+#endif
+	const unsigned char* m_pData;
+	size_t m_size;
+};
+
+#endif
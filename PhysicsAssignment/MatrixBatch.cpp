@@ -0,0 +1,101 @@
+#include "MatrixBatch.h"
+
+// one pose at a time, as btMatrix3x3::setRotation() does it. Scaling by
+// 2 / |q|^2 rather than 2 is what makes it work for any length of q
+static void PoseToMatrix(const btScalar* pPose, OpenGLMatrix &matrix) {
+	btScalar x = pPose[4], y = pPose[5], z = pPose[6], w = pPose[7];
+	btScalar s = btScalar(2.0) / (x * x + y * y + z * z + w * w);
+	btScalar xs = x * s, ys = y * s, zs = z * s;
+	btScalar wx = w * xs, wy = w * ys, wz = w * zs;
+	btScalar xx = x * xs, xy = x * ys, xz = x * zs;
+	btScalar yy = y * ys, yz = y * zs, zz = z * zs;
+
+	btScalar* m = matrix.m;
+	m[0] = btScalar(1.0) - (yy + zz);
+	m[1] = xy + wz;
+	m[2] = xz - wy;
+	m[3] = 0;
+	m[4] = xy - wz;
+	m[5] = btScalar(1.0) - (xx + zz);
+	m[6] = yz + wx;
+	m[7] = 0;
+	m[8] = xz + wy;
+	m[9] = yz - wx;
+	m[10] = btScalar(1.0) - (xx + yy);
+	m[11] = 0;
+	m[12] = pPose[0];
+	m[13] = pPose[1];
+	m[14] = pPose[2];
+	m[15] = 1;
+}
+
+void PosesToMatrices(const btScalar* pPoses, int count, OpenGLMatrix* pMatrices) {
+	int i = 0;
+
+#ifdef MATRIX_BATCH_SSE
+	// four poses at a time. Their quaternions are transposed so each
+	// register holds one component of all four, the rotation is worked
+	// out for all four at once as above, and each column of the result
+	// is transposed back into the four matrices
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	for (; i + 4 <= count; i += 4, pPoses += 4 * POSE_FLOATS, pMatrices += 4) {
+		__m128 x = _mm_load_ps(pPoses + 4);
+		__m128 y = _mm_load_ps(pPoses + POSE_FLOATS + 4);
+		__m128 z = _mm_load_ps(pPoses + 2 * POSE_FLOATS + 4);
+		__m128 w = _mm_load_ps(pPoses + 3 * POSE_FLOATS + 4);
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		__m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+		__m128 s = _mm_div_ps(two, length2);
+		__m128 xs = _mm_mul_ps(x, s), ys = _mm_mul_ps(y, s), zs = _mm_mul_ps(z, s);
+		__m128 wx = _mm_mul_ps(w, xs), wy = _mm_mul_ps(w, ys), wz = _mm_mul_ps(w, zs);
+		__m128 xx = _mm_mul_ps(x, xs), xy = _mm_mul_ps(x, ys), xz = _mm_mul_ps(x, zs);
+		__m128 yy = _mm_mul_ps(y, ys), yz = _mm_mul_ps(y, zs), zz = _mm_mul_ps(z, zs);
+
+		// each basis column of all four poses, then a zero to become
+		// the bottom row
+		__m128 c00 = _mm_sub_ps(one, _mm_add_ps(yy, zz));
+		__m128 c01 = _mm_add_ps(xy, wz);
+		__m128 c02 = _mm_sub_ps(xz, wy);
+		__m128 c03 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(c00, c01, c02, c03);
+
+		__m128 c10 = _mm_sub_ps(xy, wz);
+		__m128 c11 = _mm_sub_ps(one, _mm_add_ps(xx, zz));
+		__m128 c12 = _mm_add_ps(yz, wx);
+		__m128 c13 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(c10, c11, c12, c13);
+
+		__m128 c20 = _mm_add_ps(xz, wy);
+		__m128 c21 = _mm_sub_ps(yz, wx);
+		__m128 c22 = _mm_sub_ps(one, _mm_add_ps(xx, yy));
+		__m128 c23 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(c20, c21, c22, c23);
+
+		_mm_store_ps(pMatrices[0].m, c00);
+		_mm_store_ps(pMatrices[0].m + 4, c10);
+		_mm_store_ps(pMatrices[0].m + 8, c20);
+		_mm_store_ps(pMatrices[0].m + 12, _mm_load_ps(pPoses));
+
+		_mm_store_ps(pMatrices[1].m, c01);
+		_mm_store_ps(pMatrices[1].m + 4, c11);
+		_mm_store_ps(pMatrices[1].m + 8, c21);
+		_mm_store_ps(pMatrices[1].m + 12, _mm_load_ps(pPoses + POSE_FLOATS));
+
+		_mm_store_ps(pMatrices[2].m, c02);
+		_mm_store_ps(pMatrices[2].m + 4, c12);
+		_mm_store_ps(pMatrices[2].m + 8, c22);
+		_mm_store_ps(pMatrices[2].m + 12, _mm_load_ps(pPoses + 2 * POSE_FLOATS));
+
+		_mm_store_ps(pMatrices[3].m, c03);
+		_mm_store_ps(pMatrices[3].m + 4, c13);
+		_mm_store_ps(pMatrices[3].m + 8, c23);
+		_mm_store_ps(pMatrices[3].m + 12, _mm_load_ps(pPoses + 3 * POSE_FLOATS));
+	}
+#endif
+
+	// whatever doesn't fill a group of four
+	for (; i < count; i++, pPoses += POSE_FLOATS, pMatrices++)
+		PoseToMatrix(pPoses, *pMatrices);
+}
@@ -0,0 +1,57 @@
+#ifndef _MATRIXBATCH_H_
+#define _MATRIXBATCH_H_
+
+#include "btBulletDynamicsCommon.h"
+
+// Bullet only turns on SSE for single precision builds, and then lays
+// out its vectors and matrices as __m128s, which can be loaded directly
+#if defined(BT_USE_SSE) && !defined(BT_USE_DOUBLE_PRECISION)
+#include <xmmintrin.h>
+#define MATRIX_BATCH_SSE
+#endif
+
+// turns body transforms into OpenGL matrices in bulk. Rather than each
+// body copying its transform out and converting it on its own, a frame's
+// worth of matrices is written in one pass into one contiguous array,
+// which the draw code then reads straight from. With SSE each matrix is
+// a handful of shuffles and four aligned stores
+
+// one OpenGL matrix. An array of them is contiguous and, coming from a
+// btAlignedObjectArray, every one of them starts 16 byte aligned
+ATTRIBUTE_ALIGNED16(struct) OpenGLMatrix {
+	btScalar m[16];
+};
+
+// a position and rotation as PosesToMatrices() reads them. The 1 after
+// the position makes it load as the matrix's last column as it is
+#define POSE_FLOATS 8	// x, y, z, 1, then a quaternion's x, y, z, w
+
+// write transform's OpenGL matrix. The same as btTransform::getOpenGLMatrix()
+inline void TransformToMatrix(const btTransform &transform, OpenGLMatrix &matrix) {
+#ifdef MATRIX_BATCH_SSE
+	// the basis is kept by rows and OpenGL wants it by columns, so it is
+	// a 4x4 transpose with zeros coming in as the bottom row. The rows'
+	// fourth lanes are padding and end up in the row that's thrown away
+	const btMatrix3x3 &basis = transform.getBasis();
+	__m128 row0 = _mm_loadu_ps(basis[0].m_floats);
+	__m128 row1 = _mm_loadu_ps(basis[1].m_floats);
+	__m128 row2 = _mm_loadu_ps(basis[2].m_floats);
+	__m128 row3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+	_mm_store_ps(matrix.m, row0);
+	_mm_store_ps(matrix.m + 4, row1);
+	_mm_store_ps(matrix.m + 8, row2);
+	_mm_store_ps(matrix.m + 12, _mm_loadu_ps(transform.getOrigin().m_floats));
+	matrix.m[15] = 1.0f;
+#else
+	transform.getOpenGLMatrix(matrix.m);
+#endif
+}
+
+// write the OpenGL matrices of count poses, POSE_FLOATS apart starting at
+// pPoses, which has to be 16 byte aligned. The quaternions are normalized
+// on the way, so a blend of two can be passed in as it is
+void PosesToMatrices(const btScalar* pPoses, int count, OpenGLMatrix* pMatrices);
+
+#endif
@@ -0,0 +1,208 @@
+#include "MeshCache.h"
+
+#include "btBulletDynamicsCommon.h"
+#include <cmath>
+
+// floats per vertex: position then normal
+#define VERTEX_FLOATS 6
+
+bool MeshKey::operator<(const MeshKey &other) const {
+	if (shapeType != other.shapeType) return shapeType < other.shapeType;
+	if (radius != other.radius) return radius < other.radius;
+	if (halfHeight != other.halfHeight) return halfHeight < other.halfHeight;
+	if (slices != other.slices) return slices < other.slices;
+	return stacks < other.stacks;
+}
+
+MeshCache::MeshCache(int maxEntries)
+:
+m_clock(0),
+m_checkedExtensions(false),
+m_useBuffers(false)
+{
+	m_stats.maxEntries = maxEntries > 0 ? maxEntries : 1;
+}
+
+MeshCache::~MeshCache() {
+	Clear();
+}
+
+void MeshCache::Clear() {
+	for (Meshes::iterator it = m_meshes.begin(); it != m_meshes.end(); ++it)
+		Release(it->second);
+	m_meshes.clear();
+	m_stats.entries = 0;
+	m_stats.bytes = 0;
+}
+
+int MeshCache::DrawCylinder(float radius, float halfHeight, int slices, int stacks) {
+	MeshKey key;
+	key.shapeType = CYLINDER_SHAPE_PROXYTYPE;
+	key.radius = radius;
+	key.halfHeight = halfHeight;
+	key.slices = slices;
+	key.stacks = stacks;
+
+	const Mesh &mesh = FindOrBuild(key);
+	Draw(mesh);
+	return mesh.vertexCount / 3;
+}
+
+MeshCache::Mesh& MeshCache::FindOrBuild(const MeshKey &key) {
+	m_clock++;
+
+	Meshes::iterator it = m_meshes.find(key);
+	if (it != m_meshes.end()) {
+		m_stats.hits++;
+		it->second.lastUsed = m_clock;
+		return it->second;
+	}
+
+	// make room before adding, so we never go over the limit
+	m_stats.misses++;
+	if ((int)m_meshes.size() >= m_stats.maxEntries)
+		EvictLeastRecentlyUsed();
+
+	Mesh &mesh = m_meshes[key];
+	mesh.buffer = 0;
+	mesh.lastUsed = m_clock;
+
+	switch (key.shapeType) {
+	case CYLINDER_SHAPE_PROXYTYPE:
+		BuildCylinder(key, mesh);
+		break;
+	default:
+		mesh.vertexCount = 0;
+		break;
+	}
+
+	// hand the vertices to the driver once, if it can keep them
+	if (!m_checkedExtensions) {
+		LoadGLExtensions();
+		m_useBuffers = HasBufferObjects();
+		m_checkedExtensions = true;
+	}
+	if (m_useBuffers && mesh.vertexCount > 0) {
+		pglGenBuffers(1, &mesh.buffer);
+		pglBindBuffer(GL_ARRAY_BUFFER, mesh.buffer);
+		pglBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(GLfloat), &mesh.vertices[0], GL_STATIC_DRAW);
+		pglBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	m_stats.entries = (int)m_meshes.size();
+	m_stats.bytes += mesh.vertices.size() * sizeof(GLfloat);
+	return mesh;
+}
+
+void MeshCache::EvictLeastRecentlyUsed() {
+	Meshes::iterator oldest = m_meshes.begin();
+	for (Meshes::iterator it = m_meshes.begin(); it != m_meshes.end(); ++it) {
+		if (it->second.lastUsed < oldest->second.lastUsed)
+			oldest = it;
+	}
+	if (oldest == m_meshes.end())
+		return;
+
+	m_stats.bytes -= oldest->second.vertices.size() * sizeof(GLfloat);
+	Release(oldest->second);
+	m_meshes.erase(oldest);
+	m_stats.evictions++;
+	m_stats.entries = (int)m_meshes.size();
+}
+
+void MeshCache::Release(Mesh &mesh) {
+	if (mesh.buffer)
+		pglDeleteBuffers(1, &mesh.buffer);
+	mesh.buffer = 0;
+}
+
+// appends one vertex to the mesh
+static void PushVertex(std::vector<GLfloat> &vertices, float x, float y, float z, float nx, float ny, float nz) {
+	vertices.push_back(x);
+	vertices.push_back(y);
+	vertices.push_back(z);
+	vertices.push_back(nx);
+	vertices.push_back(ny);
+	vertices.push_back(nz);
+}
+
+void MeshCache::BuildCylinder(const MeshKey &key, Mesh &mesh) {
+	int slices = key.slices < 3 ? 3 : key.slices;
+	int stacks = key.stacks < 1 ? 1 : key.stacks;
+	float radius = key.radius;
+	float halfHeight = key.halfHeight;
+
+	// sides are two triangles per slice per stack, and each cap
+	// is a fan of one triangle per slice
+	int triangles = 2 * slices * stacks + 2 * slices;
+	mesh.vertices.reserve(triangles * 3 * VERTEX_FLOATS);
+
+	// the unit circle, shared by every ring
+	std::vector<float> cosines(slices + 1), sines(slices + 1);
+	for (int i = 0; i <= slices; i++) {
+		float angle = 2.0f * SIMD_PI * i / slices;
+		cosines[i] = cosf(angle);
+		sines[i] = sinf(angle);
+	}
+
+	// the hull, from the bottom ring to the top one
+	for (int j = 0; j < stacks; j++) {
+		float y0 = -halfHeight + 2.0f * halfHeight * j / stacks;
+		float y1 = -halfHeight + 2.0f * halfHeight * (j + 1) / stacks;
+
+		for (int i = 0; i < slices; i++) {
+			float c0 = cosines[i], s0 = sines[i];
+			float c1 = cosines[i+1], s1 = sines[i+1];
+
+			PushVertex(mesh.vertices, radius * c0, y0, radius * s0, c0, 0, s0);
+			PushVertex(mesh.vertices, radius * c0, y1, radius * s0, c0, 0, s0);
+			PushVertex(mesh.vertices, radius * c1, y1, radius * s1, c1, 0, s1);
+
+			PushVertex(mesh.vertices, radius * c0, y0, radius * s0, c0, 0, s0);
+			PushVertex(mesh.vertices, radius * c1, y1, radius * s1, c1, 0, s1);
+			PushVertex(mesh.vertices, radius * c1, y0, radius * s1, c1, 0, s1);
+		}
+	}
+
+	// the caps, facing out from each end
+	for (int i = 0; i < slices; i++) {
+		float c0 = cosines[i], s0 = sines[i];
+		float c1 = cosines[i+1], s1 = sines[i+1];
+
+		PushVertex(mesh.vertices, 0, halfHeight, 0, 0, 1, 0);
+		PushVertex(mesh.vertices, radius * c1, halfHeight, radius * s1, 0, 1, 0);
+		PushVertex(mesh.vertices, radius * c0, halfHeight, radius * s0, 0, 1, 0);
+
+		PushVertex(mesh.vertices, 0, -halfHeight, 0, 0, -1, 0);
+		PushVertex(mesh.vertices, radius * c0, -halfHeight, radius * s0, 0, -1, 0);
+		PushVertex(mesh.vertices, radius * c1, -halfHeight, radius * s1, 0, -1, 0);
+	}
+
+	mesh.vertexCount = (int)(mesh.vertices.size() / VERTEX_FLOATS);
+}
+
+void MeshCache::Draw(const Mesh &mesh) {
+	if (mesh.vertexCount == 0)
+		return;
+
+	// point the fixed function arrays either at the buffer
+	// object, or straight at our own copy of the vertices
+	const GLfloat* base = 0;
+	if (mesh.buffer)
+		pglBindBuffer(GL_ARRAY_BUFFER, mesh.buffer);
+	else
+		base = &mesh.vertices[0];
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glVertexPointer(3, GL_FLOAT, VERTEX_FLOATS * sizeof(GLfloat), base);
+	glNormalPointer(GL_FLOAT, VERTEX_FLOATS * sizeof(GLfloat), base + 3);
+
+	glDrawArrays(GL_TRIANGLES, 0, mesh.vertexCount);
+
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	if (mesh.buffer)
+		pglBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,85 @@
+#ifndef _MESHCACHE_H_
+#define _MESHCACHE_H_
+
+#include "GLExtensions.h"
+
+#include <map>
+#include <vector>
+
+// identifies one tessellated mesh. Two shapes with the same type,
+// dimensions and tessellation share the same mesh
+struct MeshKey {
+	int shapeType;
+	float radius;
+	float halfHeight;
+	int slices;
+	int stacks;
+
+	bool operator<(const MeshKey &other) const;
+};
+
+// counters describing how well the cache is doing
+struct MeshCacheStats {
+	int entries;		// meshes currently held
+	int maxEntries;		// the most meshes the cache will hold at once
+	unsigned int hits;	// draws that found their mesh already built
+	unsigned int misses;	// draws that had to build a mesh
+	unsigned int evictions; // meshes thrown away to stay under maxEntries
+	size_t bytes;		// vertex data held by all cached meshes
+
+	MeshCacheStats() : entries(0), maxEntries(0), hits(0), misses(0), evictions(0), bytes(0) {}
+};
+
+// builds each tessellated mesh once and keeps it, so drawing a shape
+// costs one draw call instead of re-tessellating it every frame. The
+// cache holds at most maxEntries meshes and drops the least recently
+// used one when a new mesh would go over that
+class MeshCache {
+public:
+	MeshCache(int maxEntries = 64);
+	~MeshCache();
+
+	// draws a cylinder of the given size centred on the origin and
+	// running along the y axis, the same way Bullet's btCylinderShape is.
+	// Returns the number of triangles drawn
+	int DrawCylinder(float radius, float halfHeight, int slices, int stacks);
+
+	// throw every mesh away
+	void Clear();
+
+	const MeshCacheStats& GetStats() const { return m_stats; }
+
+private:
+	struct Mesh {
+		// interleaved position and normal, three vertices per triangle
+		std::vector<GLfloat> vertices;
+		int vertexCount;
+
+		// the vertex buffer, or 0 if the driver has no buffer objects
+		// and vertices are drawn straight from client memory
+		GLuint buffer;
+
+		// when the mesh was last drawn, for least recently used eviction
+		unsigned int lastUsed;
+	};
+
+	typedef std::map<MeshKey, Mesh> Meshes;
+
+	Mesh& FindOrBuild(const MeshKey &key);
+	void BuildCylinder(const MeshKey &key, Mesh &mesh);
+	void EvictLeastRecentlyUsed();
+	void Draw(const Mesh &mesh);
+	void Release(Mesh &mesh);
+
+	Meshes m_meshes;
+	MeshCacheStats m_stats;
+
+	// increases on every draw, used to age meshes
+	unsigned int m_clock;
+
+	// whether LoadGLExtensions() has been checked yet
+	bool m_checkedExtensions;
+	bool m_useBuffers;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef _OBJECTPOOL_H_
+#define _OBJECTPOOL_H_
+
+#include "LinearMath/btAlignedAllocator.h"
+
+#include <new>
+#include <vector>
+
+// a slab allocator for objects of one type. Memory is taken from the
+// heap a chunk of many objects at a time, 16 byte aligned for Bullet's
+// SIMD types, and freed objects go on a free list to be handed straight
+// back out. Allocating and freeing are both O(1) and never touch the
+// heap once the pool has grown to the scene's size
+template <class T, int ChunkSize = 1024>
+class ObjectPool {
+public:
+	ObjectPool() : m_pFree(0), m_live(0), m_capacity(0) {}
+
+	// the pool only owns memory. Whoever constructed the objects
+	// must have destroyed them before the pool goes away
+	~ObjectPool() {
+		for (size_t i = 0; i < m_chunks.size(); i++)
+			btAlignedFree(m_chunks[i]);
+	}
+
+	// construct a new object in the pool
+	T* Create() {
+		return new (Allocate()) T();
+	}
+	template <class A>
+	T* Create(const A &a) {
+		return new (Allocate()) T(a);
+	}
+
+	// destroy an object made by Create() and recycle its memory
+	void Destroy(T* pObject) {
+		if (!pObject)
+			return;
+		pObject->~T();
+		Free(pObject);
+	}
+
+	// grow the pool up front so the next count Create()s don't allocate
+	void Reserve(int count) {
+		while (m_capacity - m_live < count)
+			Grow();
+	}
+
+	int GetNumLive() const { return m_live; }
+	int GetCapacity() const { return m_capacity; }
+	size_t GetBytesReserved() const { return m_chunks.size() * ChunkSize * ElementSize(); }
+
+private:
+	// a free slot doubles as a link in the free list
+	struct FreeNode {
+		FreeNode* pNext;
+	};
+
+	static size_t ElementSize() {
+		size_t size = sizeof(T) > sizeof(FreeNode) ? sizeof(T) : sizeof(FreeNode);
+		// keep every element on a 16 byte boundary
+		return (size + 15) & ~(size_t)15;
+	}
+
+	void* Allocate() {
+		if (!m_pFree)
+			Grow();
+		FreeNode* pNode = m_pFree;
+		m_pFree = pNode->pNext;
+		m_live++;
+		return pNode;
+	}
+
+	void Free(void* pMemory) {
+		FreeNode* pNode = static_cast<FreeNode*>(pMemory);
+		pNode->pNext = m_pFree;
+		m_pFree = pNode;
+		m_live--;
+	}
+
+	void Grow() {
+		size_t elementSize = ElementSize();
+		char* pChunk = static_cast<char*>(btAlignedAlloc(ChunkSize * elementSize, 16));
+		m_chunks.push_back(pChunk);
+
+		// thread the new elements onto the free list back to front, so
+		// they are handed out in address order
+		for (int i = ChunkSize - 1; i >= 0; i--)
+			Free(pChunk + i * elementSize);
+
+		// Free() counted these as released objects
+		m_live += ChunkSize;
+		m_capacity += ChunkSize;
+	}
+
+	std::vector<char*> m_chunks;
+	FreeNode* m_pFree;
+	int m_live;
+	int m_capacity;
+};
+
+#endif
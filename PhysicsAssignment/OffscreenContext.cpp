@@ -0,0 +1,78 @@
+#include "OffscreenContext.h"
+
+#include "GLExtensions.h"
+
+#ifdef HAVE_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+#include <cstdio>
+
+#ifdef HAVE_OSMESA
+// FreeGLUT can't look entry points up without a window of its own
+static void* GetOSMesaProc(const char* name) {
+	return (void*)OSMesaGetProcAddress(name);
+}
+#endif
+
+OffscreenContext::OffscreenContext()
+:
+m_pContext(0),
+m_width(0),
+m_height(0)
+{
+}
+
+OffscreenContext::~OffscreenContext() {
+	Destroy();
+}
+
+bool OffscreenContext::Create(int width, int height) {
+	Destroy();
+
+#ifdef HAVE_OSMESA
+	if (width <= 0 || height <= 0)
+		return false;
+
+	// BGRA matches the TGA files the frames are written as, and a 24 bit
+	// depth buffer matches the GLUT window's
+	OSMesaContext context = OSMesaCreateContextExt(OSMESA_BGRA, 24, 0, 0, 0);
+	if (!context) {
+		printf("could not create an offscreen OpenGL context\n");
+		return false;
+	}
+
+	m_colorBuffer.resize((size_t)width * height * 4);
+	if (!OSMesaMakeCurrent(context, &m_colorBuffer[0], GL_UNSIGNED_BYTE, width, height)) {
+		printf("could not make the offscreen OpenGL context current\n");
+		OSMesaDestroyContext(context);
+		m_colorBuffer.clear();
+		return false;
+	}
+
+	// the first row is the bottom one, as glReadPixels() returns it
+	OSMesaPixelStore(OSMESA_Y_UP, 1);
+	SetGLProcLoader(GetOSMesaProc);
+
+	m_pContext = context;
+	m_width = width;
+	m_height = height;
+	return true;
+#else
+	printf("offscreen rendering needs a build with HAVE_OSMESA defined and OSMesa linked in\n");
+	return false;
+#endif
+}
+
+void OffscreenContext::Destroy() {
+#ifdef HAVE_OSMESA
+	if (m_pContext) {
+		OSMesaDestroyContext((OSMesaContext)m_pContext);
+		SetGLProcLoader(0);
+	}
+#endif
+	m_pContext = 0;
+	m_colorBuffer.clear();
+	m_width = 0;
+	m_height = 0;
+}
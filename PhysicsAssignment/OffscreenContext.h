@@ -0,0 +1,43 @@
+#ifndef _OFFSCREENCONTEXT_H_
+#define _OFFSCREENCONTEXT_H_
+
+#include <vector>
+
+// an OpenGL context that renders into memory with Mesa's software
+// rasterizer instead of into a window, so frames can be rendered on a
+// machine with no display and no GPU. Needs OSMesa, and HAVE_OSMESA
+// defined when this is compiled. Without it Create() always fails. The
+// Release_OSMesa configuration does both, with Mesa in ..\..\OSMesa.
+// osmesa.lib comes ahead of opengl32.lib there, so every GL call goes
+// to Mesa, and that build is for --offscreen only
+class OffscreenContext {
+public:
+	OffscreenContext();
+	~OffscreenContext();
+
+	// make a width x height context with a depth buffer and make it
+	// current. Prints why and returns false if it can't
+	bool Create(int width, int height);
+	void Destroy();
+
+	bool IsCreated() const { return m_pContext != 0; }
+
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+
+private:
+	// not copyable, the context belongs to one object
+	OffscreenContext(const OffscreenContext &);
+	OffscreenContext& operator=(const OffscreenContext &);
+
+	// an OSMesaContext, kept as void* to leave osmesa.h out of the header
+	void* m_pContext;
+
+	// the color buffer Mesa renders into
+	std::vector<unsigned char> m_colorBuffer;
+
+	int m_width;
+	int m_height;
+};
+
+#endif
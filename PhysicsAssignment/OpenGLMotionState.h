@@ -3,15 +3,55 @@
 
 #include "btBulletCollisionCommon.h"
 
+#include <vector>
+
+// a motion state that keeps track of whether its body's OpenGL matrix
+// needs rebuilding. Bullet only calls setWorldTransform() for bodies that
+// are awake, so a body that has gone to sleep stops costing anything to
+// draw. Every time the transform changes the motion state marks itself
+// dirty and, if it has been given one, adds its id to a shared dirty
+// list. The matrices themselves are kept by the owner, all together, so
+// it can rebuild just the ones that changed in one pass
 class OpenGLMotionState : public btDefaultMotionState {
 public:
-	OpenGLMotionState(const btTransform &transform) : btDefaultMotionState(transform) {}
+	OpenGLMotionState(const btTransform &transform)
+	:
+	btDefaultMotionState(transform),
+	m_pDirtyList(0),
+	m_dirtyId(0),
+	m_dirty(false)
+	{
+	}
 
-	void GetWorldTransform(btScalar* transform) {
-		btTransform trans;
-		getWorldTransform(trans);
-		trans.getOpenGLMatrix(transform);
+	// called by Bullet every step the body moves
+	virtual void setWorldTransform(const btTransform &transform) {
+		btDefaultMotionState::setWorldTransform(transform);
+		MarkDirty();
 	}
+
+	// where to report this motion state's id when it changes
+	void SetDirtyList(std::vector<unsigned int>* pDirtyList, unsigned int id) {
+		m_pDirtyList = pDirtyList;
+		m_dirtyId = id;
+	}
+
+	void MarkDirty() {
+		if (m_dirty)
+			return;
+		m_dirty = true;
+		if (m_pDirtyList)
+			m_pDirtyList->push_back(m_dirtyId);
+	}
+
+	bool IsDirty() const { return m_dirty; }
+
+	// the owner has rebuilt the matrix from m_graphicsWorldTrans
+	void ClearDirty() { m_dirty = false; }
+
+private:
+	std::vector<unsigned int>* m_pDirtyList;
+	unsigned int m_dirtyId;
+	bool m_dirty;
 };
 
-#endif
\ No newline at end of file
+#endif
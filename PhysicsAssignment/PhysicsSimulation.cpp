@@ -0,0 +1,503 @@
+#include "PhysicsSimulation.h"
+#include "DominoLayout.h"
+
+#include "LinearMath/btTransformUtil.h"
+
+#include <cstdio>
+
+// the most manifolds, and collision algorithms, pooled up front. A quarter
+// of a million manifolds is a couple of hundred megabytes
+#define MAX_POOL_ELEMENTS (1 << 18)
+
+#ifdef BT_THREADSAFE
+#include "BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h"
+#include "LinearMath/btThreads.h"
+
+// Bullet has one task scheduler for the whole process, so it is made
+// the first time a multithreaded world needs it and then just resized
+static btITaskScheduler* GetTaskScheduler() {
+	static btITaskScheduler* pScheduler = 0;
+	if (!pScheduler) {
+		pScheduler = btCreateDefaultTaskScheduler();
+		if (pScheduler)
+			btSetTaskScheduler(pScheduler);
+	}
+	return pScheduler;
+}
+#endif
+
+PhysicsSimulation::PhysicsSimulation()
+:
+start(0),
+m_requestedThreads(1),
+m_numThreads(1),
+m_numCcdBodies(0),
+m_pBroadphase(0),
+m_pPairCache(0),
+m_pCollisionConfiguration(0),
+m_pDispatcher(0),
+m_pSolver(0),
+m_pSolverMt(0),
+m_pWorld(0),
+m_entities(m_shapes),
+m_pRecorder(0)
+{
+}
+
+PhysicsSimulation::~PhysicsSimulation() {
+	// the world has to go first, while the broadphase
+	// it removes the bodies from still exists
+	delete m_pWorld;
+
+	m_entities.Clear();
+
+	delete m_pSolverMt;
+	delete m_pSolver;
+	delete m_pBroadphase;
+	delete m_pPairCache;
+	delete m_pDispatcher;
+	delete m_pCollisionConfiguration;
+}
+
+void PhysicsSimulation::Initialize() {
+	// everything that grows with the number of contacts is sized from the
+	// scene up front, so the steps allocate nothing once it settles in
+	int bodies = GetExpectedBodies();
+	int pairs = bodies * m_broadphaseSettings.pairsPerBody;
+
+	// create the collision configuration. Manifolds and collision
+	// algorithms come from its pools, and Bullet goes to the heap for
+	// each one once a pool runs out. A pool is a single block, though,
+	// so a huge scene gets capped pools rather than one it can't map
+	btDefaultCollisionConstructionInfo info;
+	int poolSize = btMin(btMax(pairs, info.m_defaultMaxPersistentManifoldPoolSize), MAX_POOL_ELEMENTS);
+	info.m_defaultMaxPersistentManifoldPoolSize = poolSize;
+	info.m_defaultMaxCollisionAlgorithmPoolSize = poolSize;
+	m_pCollisionConfiguration = new btDefaultCollisionConfiguration(info);
+	// create the dispatcher, which also reports contacts for the
+	// bodies that subscribe to them
+	m_pDispatcher = new ContactEventDispatcher(m_pCollisionConfiguration);
+	m_pDispatcher->ReserveManifolds(pairs);
+	// create the broadphase, with a pair cache that won't have to grow
+	// while the scene settles. The wavefront looks up the neighbours of
+	// each domino it freezes or wakes
+	btVector3 boundsMin, boundsMax;
+	GetSceneBounds(boundsMin, boundsMax);
+	m_pPairCache = CreatePairCache(pairs);
+	m_pBroadphase = CreateBroadphase(m_broadphaseSettings.type, boundsMin, boundsMax, bodies, m_pPairCache, m_wavefrontSettings.enabled);
+
+	m_numThreads = 1;
+#ifdef BT_THREADSAFE
+	btITaskScheduler* pScheduler = m_requestedThreads > 1 ? GetTaskScheduler() : 0;
+	if (pScheduler) {
+		// the scheduler clamps this to the threads it can actually run
+		pScheduler->setNumThreads(m_requestedThreads);
+		m_numThreads = pScheduler->getNumThreads();
+
+		// a pool of solvers, one per thread, so independent islands are
+		// solved in parallel, plus a parallel solver for any island too
+		// big to split up
+		btAlignedObjectArray<btConstraintSolver*> solvers;
+		for (int i = 0; i < m_numThreads; i++)
+			solvers.push_back(CreateSolver(m_solverSettings.type));
+		btConstraintSolverPoolMt* pSolverPool = new btConstraintSolverPoolMt(&solvers[0], m_numThreads);
+		m_pSolver = pSolverPool;
+		m_pSolverMt = new btSequentialImpulseConstraintSolverMt();
+		m_pWorld = new btDiscreteDynamicsWorldMt(m_pDispatcher, m_pBroadphase, pSolverPool, m_pSolverMt, m_pCollisionConfiguration);
+	}
+	else if (m_requestedThreads > 1) {
+		printf("no task scheduler available, stepping on one thread\n");
+	}
+#else
+	if (m_requestedThreads > 1)
+		printf("built without BT_THREADSAFE, stepping on one thread\n");
+#endif
+
+	if (!m_pWorld) {
+		// create the constraint solver
+		m_pSolver = CreateSolver(m_solverSettings.type);
+		// create the world
+		m_pWorld = new btDiscreteDynamicsWorld(m_pDispatcher, m_pBroadphase, m_pSolver, m_pCollisionConfiguration);
+	}
+	// iterations, warm starting and the rest are read from the world's
+	// solver info every step, whichever solvers it has
+	ApplySolverSettings(m_solverSettings, m_pWorld->getSolverInfo());
+
+	// collect contact events after every internal step
+	m_pWorld->setInternalTickCallback(InternalTickCallback, this);
+
+	// create a ground plane
+	CreateGround();
+
+	// create our scene's physics objects
+	CreateObjects();
+
+	// freeze everything away from the chains' fronts. Bullet updates the
+	// bounds of every body every step unless told to stick to the awake
+	// ones, which would make the frozen dominos cost something after all
+	if (m_wavefrontSettings.enabled) {
+		m_pWorld->setForceUpdateAllAabbs(false);
+		std::vector<btRigidBody*> bodies(dominos.size());
+		for (int i = 0; i < dominos.size(); i++)
+			bodies[i] = GetDominoBody(i);
+		m_wavefront.Attach(m_pWorld, bodies, m_leads, m_wavefrontSettings);
+	}
+
+	start = 0;
+
+	// remember how everything was set up, so resetting is just a copy
+	m_initialState.Capture(m_pWorld);
+}
+
+void PhysicsSimulation::UpdateScene(float dt, int maxSubSteps, float fixedTimeStep) {
+	// check if the world object exists
+	if (m_pWorld) {
+		// step the simulation through time. The amount of
+		// elapsed time is decided by whoever drives us, either
+		// the application's clock or a fixed headless step
+		PROFILE_PHASE(PHASE_STEP);
+		m_pWorld->stepSimulation(dt, maxSubSteps, fixedTimeStep);
+	}
+
+	// deliver the contacts from this update
+	{
+		PROFILE_PHASE(PHASE_COLLISION_EVENTS);
+		CheckForCollisionEvents();
+	}
+
+	// if the first domino hasnt already tipped over and started the chain reaction
+	if(start == 0 && !dominos.empty())
+	{
+		// apply a force to the first domino, starting the chain reaction
+		PushDomino(0);
+
+		// and to the heads of any other chains alongside it
+		for (int i = 0; i < m_leads.size(); i++) {
+			if (m_leads[i] != 0 && m_leads[i] < dominos.size())
+				PushDomino(m_leads[i]);
+		}
+	}
+}
+
+int PhysicsSimulation::GetMaxThreads() {
+#ifdef BT_THREADSAFE
+	btITaskScheduler* pScheduler = GetTaskScheduler();
+	if (pScheduler)
+		return pScheduler->getMaxNumThreads();
+#endif
+	return 1;
+}
+
+int PhysicsSimulation::RunFixedSteps(float dt, int maxSteps, bool stopWhenAsleep) {
+	int steps = 0;
+	while (steps < maxSteps) {
+		// a maxSubSteps of 0 makes Bullet step by exactly dt
+		UpdateScene(dt, 0);
+		steps++;
+
+		// nothing left moving, so further steps would be wasted
+		if (stopWhenAsleep && IsAtRest())
+			break;
+	}
+	return steps;
+}
+
+void PhysicsSimulation::Reset() {
+	// put every body back where Initialize() left it. The bodies
+	// stay in the world, so nothing is rebuilt or reallocated. Frozen
+	// dominos get their mass back first, and the snapshot wakes or
+	// sends to sleep whatever it saved that way
+	m_wavefront.Reset();
+	if (!m_initialState.Restore(m_pWorld)) {
+		printf("the world has changed since it was set up, so it can't be reset\n");
+		return;
+	}
+	// with everything back in place, sort out which pairs the frozen
+	// and woken dominos should have
+	m_wavefront.UpdatePairs();
+
+	// contacts from before the reset no longer mean anything
+	m_pDispatcher->ClearEvents();
+
+	// the bodies jumped back without moving, so a recording has to
+	// write them all out again
+	if (m_pRecorder)
+		m_pRecorder->ForceKeyframe();
+
+	// push the first domino again
+	start = 0;
+}
+
+int PhysicsSimulation::GetNumActiveBodies() const {
+	if (!m_pWorld)
+		return 0;
+
+	int active = 0;
+	const btCollisionObjectArray &objects = m_pWorld->getCollisionObjectArray();
+	for (int i = 0; i < objects.size(); i++) {
+		// the ground never moves, so it is neither awake nor asleep
+		if (!objects[i]->isStaticOrKinematicObject() && objects[i]->isActive())
+			active++;
+	}
+	return active;
+}
+
+int PhysicsSimulation::GetNumSleepingBodies() const {
+	if (!m_pWorld)
+		return 0;
+
+	int sleeping = 0;
+	const btCollisionObjectArray &objects = m_pWorld->getCollisionObjectArray();
+	for (int i = 0; i < objects.size(); i++) {
+		if (!objects[i]->isStaticOrKinematicObject() && !objects[i]->isActive())
+			sleeping++;
+	}
+	return sleeping;
+}
+
+void PhysicsSimulation::InterpolateMotionStates(btScalar lag) {
+	if (!m_pWorld)
+		return;
+
+	const btCollisionObjectArray &objects = m_pWorld->getCollisionObjectArray();
+	for (int i = 0; i < objects.size(); i++) {
+		btRigidBody* pBody = btRigidBody::upcast(objects[i]);
+		if (!pBody || pBody->isStaticOrKinematicObject() || !pBody->getMotionState())
+			continue;
+
+		// every body's motion state is an OpenGLMotionState
+		btDefaultMotionState* pState = static_cast<btDefaultMotionState*>(pBody->getMotionState());
+		const btTransform &transform = pBody->getWorldTransform();
+
+		if (!pBody->isActive()) {
+			// Bullet stops updating a body's motion state once it sleeps,
+			// which can leave it where it was last drawn, a little behind
+			if (pState->m_graphicsWorldTrans.getOrigin() != transform.getOrigin())
+				pState->setWorldTransform(transform);
+			continue;
+		}
+
+		// each step moves a body by its velocity afterwards, so stepping
+		// back along that velocity retraces the step exactly
+		if (lag > 0.0f) {
+			btTransform interpolated;
+			btTransformUtil::integrateTransform(transform, pBody->getLinearVelocity(), pBody->getAngularVelocity(), -lag, interpolated);
+			pState->setWorldTransform(interpolated);
+		} else {
+			pState->setWorldTransform(transform);
+		}
+	}
+}
+
+btScalar PhysicsSimulation::GetMaxSafeStep() const {
+	if (!m_pWorld)
+		return 0.0f;
+
+	// how fast any point of any awake body is moving, taking the
+	// spin into account the same way Bullet bounds motion for CCD
+	btScalar maxSpeed = 0.0f;
+	const btCollisionObjectArray &objects = m_pWorld->getCollisionObjectArray();
+	for (int i = 0; i < objects.size(); i++) {
+		const btRigidBody* pBody = btRigidBody::upcast(objects[i]);
+		if (!pBody || pBody->isStaticOrKinematicObject() || !pBody->isActive())
+			continue;
+		btScalar speed = pBody->getLinearVelocity().length()
+			+ pBody->getAngularVelocity().length() * pBody->getCollisionShape()->getAngularMotionDisc();
+		if (speed > maxSpeed)
+			maxSpeed = speed;
+	}
+
+	if (maxSpeed <= SIMD_EPSILON)
+		return 0.0f;
+	return DOMINO_HALF_EXTENTS.z() / maxSpeed;
+}
+
+EntityHandle PhysicsSimulation::CreateGameObject(btCollisionShape* pShape, const float &mass, const btVector3 &color, const btVector3 &initialPosition, const btQuaternion &initialRotation) {
+	// create a new game object
+	EntityDesc desc;
+	desc.kind = ENTITY_OBJECT;
+	desc.pShape = pShape;
+	desc.mass = mass;
+	desc.color = color;
+	desc.position = initialPosition;
+	desc.orientation = initialRotation;
+	return AddEntity(desc);
+}
+
+EntityHandle PhysicsSimulation::CreateDomino(const btVector3 &initialPosition, const btQuaternion &orientation) {
+	// every domino is the same size, so they all share one shape
+	EntityDesc desc;
+	desc.kind = ENTITY_DOMINO;
+	desc.pShape = m_shapes.AcquireBox(DOMINO_HALF_EXTENTS);
+	desc.mass = m_dominoParams.mass;
+	desc.color = btVector3(1.0f, 0.2f, 0.2f);
+	desc.position = initialPosition;
+	desc.orientation = orientation;
+	return AddEntity(desc);
+}
+
+EntityHandle PhysicsSimulation::AddEntity(const EntityDesc &desc) {
+	EntityHandle handle = m_entities.Create(desc);
+	btRigidBody* pBody = m_entities.Get(handle)->pBody;
+
+	if (desc.kind == ENTITY_DOMINO) {
+		// push it to the back of the list
+		dominos.push_back(handle);
+
+		// the first domino hitting the second is what stops the
+		// push, so it is the only one that needs contact events
+		if (dominos.size() == 1)
+			ContactEventDispatcher::Subscribe(pBody);
+
+		pBody->setFriction(m_dominoParams.friction);
+	}
+
+	// thin boxes, dominos or not, get swept when they move fast
+	if (SetupContinuousCollision(pBody, m_ccdSettings))
+		m_numCcdBodies++;
+
+	// check if the world object is valid
+	if (m_pWorld) {
+		// add the object's rigid body to the world
+		m_pWorld->addRigidBody(pBody);
+	}
+	return handle;
+}
+
+void PhysicsSimulation::PushDomino(int i) {
+	// a domino falls across its thin side, which is its local z axis
+	btRigidBody* pBody = GetDominoBody(i);
+	btVector3 facing = pBody->getWorldTransform().getBasis().getColumn(2);
+	pBody->applyCentralForce(facing * m_dominoParams.pushForce);
+}
+
+bool PhysicsSimulation::IsDominoToppled(int i) {
+	// a domino's long side is its local x axis, which points up while it stands
+	return btFabs(GetDominoBody(i)->getWorldTransform().getBasis()[1][0]) < DOMINO_TOPPLE_COS;
+}
+
+void PhysicsSimulation::GetSceneBounds(btVector3 &boundsMin, btVector3 &boundsMax) const {
+	// the demo's ground, and a little above it
+	boundsMin = btVector3(-50.0f, -1.0f, -50.0f);
+	boundsMax = btVector3(50.0f, 10.0f, 50.0f);
+}
+
+int PhysicsSimulation::GetExpectedBodies() const {
+	// the hand-placed scene has a few dozen
+	return 64;
+}
+
+void PhysicsSimulation::CreateGround() {
+	CreateGameObject(m_shapes.AcquireBox(btVector3(1,50,50)), 0, btVector3(0.2f, 0.6f, 0.6f), btVector3(0.0f, 0.0f, 0.0f));
+}
+
+void PhysicsSimulation::CreateObjects() {
+
+	float x, z, y;
+	z = -17.0f;
+	x = 0.0f;
+	y = 0.0f;
+
+	// the original hand-placed scene. Curves and spirals need rotated
+	// dominos, which only work since the rotation went into the body
+	// itself rather than just the drawing. They are generated by
+	// DominoLayout and can be saved as scene files, see SceneFile.h
+	btQuaternion rotation = DominoOrientation(0.0f);
+
+	// set up first 6 dominos
+	for (int i = 0; i < 6; i++)
+	{
+		CreateDomino(btVector3(x, y, z), rotation);
+		z += 1.5;
+	}
+
+	// create a blue cylinder
+	CreateGameObject(m_shapes.AcquireCylinder(btVector3(1,2.0,1)), 2.0, btVector3(0.0f, 0.0f, 8.0f), btVector3(x, y, z));
+
+	z += 5;
+	x = -1;
+	int x2 = 1;
+
+	// set up next 12 dominos in 2 lines
+	for (int i = 0; i < 6; i++)
+	{
+		CreateDomino(btVector3(x, y, z), rotation);
+		CreateDomino(btVector3(x2, y, z), rotation);
+		z += 1.5;
+	}
+}
+
+void PhysicsSimulation::InternalTickCallback(btDynamicsWorld* pWorld, btScalar timeStep) {
+	static_cast<PhysicsSimulation*>(pWorld->getWorldUserInfo())->OnInternalTick(timeStep);
+}
+
+void PhysicsSimulation::OnInternalTick(btScalar timeStep) {
+	// turn this step's contacts into events
+	m_pDispatcher->ProcessContacts();
+
+	// follow the toppling fronts
+	if (m_wavefront.IsAttached())
+		m_wavefront.Update();
+
+	// and save where everything ended up
+	if (m_pRecorder)
+		m_pRecorder->RecordStep(m_entities, timeStep);
+}
+
+void PhysicsSimulation::CheckForCollisionEvents() {
+	// only subscribed bodies have events, so this no longer
+	// depends on how many other contacts there are
+	for (int i = 0; i < m_pDispatcher->GetNumEvents(); ++i) {
+		const ContactEvent &event = m_pDispatcher->GetEvent(i);
+		if (m_wavefront.IsAttached())
+			m_wavefront.OnContact(event);
+		CollisionEvent(event);
+	}
+
+	m_pDispatcher->ClearEvents();
+}
+
+void PhysicsSimulation::CollisionEvent(const ContactEvent &event)
+{
+	if (event.type != CONTACT_BEGIN || dominos.size() < 2)
+		return;
+
+	const btCollisionObject* pBody0 = event.pBody0;
+	const btCollisionObject* pBody1 = event.pBody1;
+
+	// if one of the collided dominos is the first
+	if(pBody0 == GetDominoBody(0) || pBody1 == GetDominoBody(0))
+	{
+		//if one of the collided dominos id the second
+		if(pBody0 == GetDominoBody(1) || pBody1 == GetDominoBody(1))
+		{
+			// stop tipping over the first (applying the force to it)
+			start = 1;
+		}
+	}
+}
+
+ToppleTracker::ToppleTracker(PhysicsSimulation* pSimulation)
+:
+m_pSimulation(pSimulation),
+m_fallen(pSimulation->GetDominos().size(), 0),
+m_toppled(0),
+m_firstTopple(-1.0f),
+m_completionTime(-1.0f)
+{
+	m_times.reserve(m_fallen.size());
+}
+
+void ToppleTracker::Update(float time) {
+	for (int i = 0; i < m_fallen.size(); i++) {
+		if (m_fallen[i] || !m_pSimulation->GetDominoBody(i)->isActive() || !m_pSimulation->IsDominoToppled(i))
+			continue;
+		m_fallen[i] = 1;
+		m_toppled++;
+		m_times.push_back(time);
+		if (m_firstTopple < 0.0f)
+			m_firstTopple = time;
+		m_completionTime = time;
+	}
+}
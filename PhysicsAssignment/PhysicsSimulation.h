@@ -0,0 +1,262 @@
+#ifndef _PHYSICSSIMULATION_H_
+#define _PHYSICSSIMULATION_H_
+
+#include "btBulletDynamicsCommon.h"
+
+// the multithreaded world with its solver pool and parallel solver, the
+// NNCG solver, a body's second user index and the profiler's zone hooks
+// are all used. The solver pool and the parallel solver arrived in 2.88
+#if BT_BULLET_VERSION < 288
+#error "this needs Bullet 2.88 or newer"
+#endif
+
+#include "ContactEventDispatcher.h"
+#include "EntityStore.h"
+#include "ShapeRegistry.h"
+#include "WorldSnapshot.h"
+#include "Trajectory.h"
+#include "FrameProfiler.h"
+#include "DominoLayout.h"
+#include "WavefrontActivation.h"
+#include "BroadphaseFactory.h"
+#include "SolverProfile.h"
+#include "ContinuousCollision.h"
+#include <vector>
+
+// the dominos in toppling order
+typedef std::vector<EntityHandle> DominoHandles;
+
+// the physical properties every domino in a simulation shares
+struct DominoParams {
+	float mass;
+	float friction;
+	float pushForce;		// applied to each lead domino every update until the chain starts
+
+	DominoParams() : mass(DOMINO_MASS), friction(DOMINO_FRICTION), pushForce(DOMINO_PUSH_FORCE) {}
+};
+
+// the physics half of the demo. It owns the Bullet world and every
+// body in it, but knows nothing about windows or OpenGL, so it can be
+// stepped by the FreeGLUT application or on its own from the command line
+class PhysicsSimulation {
+public:
+	PhysicsSimulation();
+	virtual ~PhysicsSimulation();
+
+	// the number of threads to step the world with. Must be set before
+	// Initialize(). Anything above 1 builds Bullet's multithreaded world,
+	// which needs a Bullet built with BT_THREADSAFE, and BT_THREADSAFE
+	// defined here too. Otherwise the world stays single threaded
+	void SetNumThreads(int threads) { m_requestedThreads = threads; }
+
+	// how heavy and grippy the dominos are and how hard they are pushed.
+	// Must be set before Initialize()
+	void SetDominoParams(const DominoParams &params) { m_dominoParams = params; }
+	const DominoParams& GetDominoParams() const { return m_dominoParams; }
+
+	// only simulate the dominos near each chain's toppling front, so a
+	// step costs the same however long the chains are. Off by default.
+	// Must be set before Initialize()
+	void SetWavefront(const WavefrontSettings &settings) { m_wavefrontSettings = settings; }
+
+	// which broadphase to build and how big a pair cache to give it.
+	// Must be set before Initialize()
+	void SetBroadphase(const BroadphaseSettings &settings) { m_broadphaseSettings = settings; }
+	const BroadphaseSettings& GetBroadphaseSettings() const { return m_broadphaseSettings; }
+	const WavefrontActivation& GetWavefront() const { return m_wavefront; }
+
+	// which constraint solver to build and how hard it works, usually
+	// from GetSolverProfile(). Must be set before Initialize()
+	void SetSolver(const SolverSettings &settings) { m_solverSettings = settings; }
+	const SolverSettings& GetSolverSettings() const { return m_solverSettings; }
+
+	// continuous collision for thin boxes, so a larger step doesn't let a
+	// falling domino pass through the next. On by default. Must be set
+	// before Initialize()
+	void SetCcd(const CcdSettings &settings) { m_ccdSettings = settings; }
+	const CcdSettings& GetCcdSettings() const { return m_ccdSettings; }
+
+	// how many bodies continuous collision was turned on for
+	int GetNumCcdBodies() const { return m_numCcdBodies; }
+
+	// the threads the world actually ended up using
+	int GetNumThreads() const { return m_numThreads; }
+
+	// the most threads the task scheduler can run, or 1 without one
+	static int GetMaxThreads();
+
+	// builds the world, the ground plane and the scene's objects
+	void Initialize();
+
+	// scene updating. Can be overridden by derived classes. maxSubSteps
+	// and fixedTimeStep are handed straight to stepSimulation(), so passing
+	// a maxSubSteps of 0 steps the world by exactly dt
+	virtual void UpdateScene(float dt, int maxSubSteps = 1, float fixedTimeStep = 1.0f / 60.0f);
+
+	// steps the world at a fixed dt for at most maxSteps steps, stopping
+	// early if stopWhenAsleep is set and every body has gone to sleep.
+	// Returns the number of steps taken
+	int RunFixedSteps(float dt, int maxSteps, bool stopWhenAsleep);
+
+	// put the scene back as Initialize() built it, in place
+	void Reset();
+
+	// write every simulation step to a recording, or stop with 0. The
+	// recorder must already be open on this simulation's entities
+	void SetRecorder(TrajectoryRecorder* pRecorder) { m_pRecorder = pRecorder; }
+
+	// body counters, ignoring static objects such as the ground
+	int GetNumActiveBodies() const;
+	int GetNumSleepingBodies() const;
+	bool IsAtRest() const { return GetNumActiveBodies() == 0; }
+
+	// move every awake body's motion state lag seconds back along its
+	// velocity, so it is drawn part way between its last two steps. A lag
+	// of 0 puts them back where the bodies are. Only the motion states
+	// move, never the bodies, so the simulation is unaffected
+	void InterpolateMotionStates(btScalar lag);
+
+	// the longest step in which no awake body, spinning included, moves
+	// further than half a domino's depth, so that no domino can be
+	// stepped clean through another. 0 if nothing is moving
+	btScalar GetMaxSafeStep() const;
+
+	// accessors
+	btDynamicsWorld* GetWorld() { return m_pWorld; }
+	btBroadphaseInterface* GetBroadphase() { return m_pBroadphase; }
+	btHashedOverlappingPairCache* GetPairCache() { return m_pPairCache; }
+	btCollisionDispatcher* GetDispatcher() { return m_pDispatcher; }
+	EntityStore& GetEntities() { return m_entities; }
+	DominoHandles& GetDominos() { return dominos; }
+	ShapeRegistry& GetShapes() { return m_shapes; }
+
+	// the rigid body of the i'th domino in toppling order
+	btRigidBody* GetDominoBody(int i) { return m_entities.Get(dominos.at(i))->pBody; }
+	const WorldSnapshot& GetInitialState() const { return m_initialState; }
+
+	// pShape must come from GetShapes(). The new object takes over that reference
+	EntityHandle CreateGameObject(btCollisionShape* pShape,
+			const float &mass,
+			const btVector3 &color = btVector3(1.0f,1.0f,1.0f),
+			const btVector3 &initialPosition = btVector3(0.0f,0.0f,0.0f),
+			const btQuaternion &initialRotation = btQuaternion(0,0,1,1));
+
+	// orientation is the body's real orientation, usually from DominoOrientation()
+	EntityHandle CreateDomino(const btVector3 &initialPosition, const btQuaternion &orientation);
+
+	// push the i'th domino the way it faces
+	void PushDomino(int i);
+
+	// whether the i'th domino leans further than DOMINO_TOPPLE_COS from upright
+	bool IsDominoToppled(int i);
+
+	// make room for count more bodies before a big scene is built
+	void ReserveEntities(int count) { m_entities.Reserve(count); }
+
+	// the floor everything stands on. Can be overridden by derived
+	// classes whose scenes don't fit on the default 100x100 plane
+	virtual void CreateGround();
+
+	virtual void CreateObjects();
+
+	// roughly where the scene's bodies start out and how many there
+	// are, for sizing the broadphase before any of them exist. Derived
+	// classes whose scenes aren't the demo's override both
+	virtual void GetSceneBounds(btVector3 &boundsMin, btVector3 &boundsMax) const;
+	virtual int GetExpectedBodies() const;
+
+	// hand the contact events queued since the last update to CollisionEvent()
+	void CheckForCollisionEvents();
+
+	virtual void CollisionEvent(const ContactEvent &event);
+
+protected:
+	// called by Bullet after every internal step, however many
+	// stepSimulation() takes per update
+	static void InternalTickCallback(btDynamicsWorld* pWorld, btScalar timeStep);
+	virtual void OnInternalTick(btScalar timeStep);
+
+	// build an entity and add its body to the world. Dominos are
+	// appended to the toppling order as well
+	EntityHandle AddEntity(const EntityDesc &desc);
+
+	int start;
+
+	int m_requestedThreads;
+	int m_numThreads;
+
+	DominoParams m_dominoParams;
+
+	WavefrontSettings m_wavefrontSettings;
+	BroadphaseSettings m_broadphaseSettings;
+	SolverSettings m_solverSettings;
+	CcdSettings m_ccdSettings;
+	int m_numCcdBodies;
+	WavefrontActivation m_wavefront;
+
+	// core Bullet components
+	btBroadphaseInterface* m_pBroadphase;
+	btHashedOverlappingPairCache* m_pPairCache;	// the broadphase's, but not owned by it
+	btCollisionConfiguration* m_pCollisionConfiguration;
+	ContactEventDispatcher* m_pDispatcher;
+	btConstraintSolver* m_pSolver;
+	btConstraintSolver* m_pSolverMt;	// the multithreaded world's solver for large islands, if any
+	btDynamicsWorld* m_pWorld;
+
+	// shared collision shapes for every body in the world. Declared
+	// before m_entities, which releases its shapes into it
+	ShapeRegistry m_shapes;
+
+	// every body in the world, game objects and dominos alike
+	EntityStore m_entities;
+
+	DominoHandles dominos;
+
+	// the index in dominos of the first domino of each chain. Each is
+	// pushed the way it faces until the first domino hits the second.
+	// The first domino is always pushed, whether it is listed or not
+	std::vector<int> m_leads;
+
+	// the scene as Initialize() built it, for Reset()
+	WorldSnapshot m_initialState;
+
+	// where each step is recorded, if anywhere
+	TrajectoryRecorder* m_pRecorder;
+};
+
+// keeps count of which of a simulation's dominos have toppled, and
+// when the first and the last of them did, from IsDominoToppled()
+// checked after every step. Only awake dominos can have moved, so the
+// rest aren't looked at
+class ToppleTracker {
+public:
+	// follow every domino pSimulation has, none of them fallen yet
+	explicit ToppleTracker(PhysicsSimulation* pSimulation);
+
+	// check the dominos that were still standing, time simulated
+	// seconds in
+	void Update(float time);
+
+	int GetNumToppled() const { return m_toppled; }
+	int GetNumDominos() const { return (int)m_fallen.size(); }
+	bool IsComplete() const { return m_toppled == (int)m_fallen.size(); }
+
+	// simulated seconds until the first and the last domino to fall
+	// fell, or -1 if none has
+	float GetFirstTopple() const { return m_firstTopple; }
+	float GetCompletionTime() const { return m_completionTime; }
+
+	// the simulated seconds by which k + 1 dominos had fallen, for each
+	// k up to GetNumToppled(), so two runs can be compared over however
+	// far both of them got
+	const std::vector<float>& GetToppleTimes() const { return m_times; }
+
+private:
+	PhysicsSimulation* m_pSimulation;
+	std::vector<unsigned char> m_fallen;
+	std::vector<float> m_times;
+	int m_toppled;
+	float m_firstTopple;
+	float m_completionTime;
+};
+#endif
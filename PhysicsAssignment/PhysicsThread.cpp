@@ -0,0 +1,205 @@
+#include "PhysicsThread.h"
+
+PhysicsThread::PhysicsThread()
+:
+m_pSimulation(0),
+m_stopRequested(false),
+m_resetRequested(false),
+m_paused(false),
+m_interpolate(true),
+m_steps(0),
+m_settingsChanged(false),
+m_writeSlot(0),
+m_latest(1),
+m_previousSlot(2),
+m_currentSlot(3)
+{
+}
+
+PhysicsThread::~PhysicsThread() {
+	Stop();
+}
+
+void PhysicsThread::Start(PhysicsSimulation* pSimulation, const TimeStepSettings &settings) {
+	Stop();
+
+	m_pSimulation = pSimulation;
+	m_timeStep.SetSettings(settings);
+	m_interpolate = settings.interpolate;
+	m_settingsChanged = false;
+	m_stats = TimeStepStats();
+	m_clock.reset();
+	m_stopRequested = false;
+	m_resetRequested = false;
+	m_steps = 0;
+
+	// every snapshot starts as the scene stands, so the first frames
+	// have something to draw before the first step is published
+	m_writeSlot = 0;
+	m_latest = 1;
+	m_previousSlot = 2;
+	m_currentSlot = 3;
+	for (int i = 0; i < NUM_SNAPSHOTS; i++)
+		Capture(m_snapshots[i]);
+	int count = pSimulation->GetEntities().GetNumEntities();
+	m_poses.resize(count * POSE_FLOATS);
+	m_matrices.resize(count);
+
+	m_thread = std::thread(&PhysicsThread::Run, this);
+}
+
+void PhysicsThread::Stop() {
+	if (!m_thread.joinable())
+		return;
+	m_stopRequested = true;
+	m_thread.join();
+}
+
+void PhysicsThread::SetTimeStep(const TimeStepSettings &settings) {
+	std::lock_guard<std::mutex> lock(m_timeStepMutex);
+	m_newSettings = settings;
+	m_settingsChanged = true;
+	m_interpolate = settings.interpolate;
+}
+
+TimeStepStats PhysicsThread::GetTimeStepStats() {
+	std::lock_guard<std::mutex> lock(m_timeStepMutex);
+	return m_stats;
+}
+
+void PhysicsThread::Run() {
+	double last = Now();
+
+	while (!m_stopRequested) {
+		{
+			std::lock_guard<std::mutex> lock(m_timeStepMutex);
+			if (m_settingsChanged) {
+				m_timeStep.SetSettings(m_newSettings);
+				m_settingsChanged = false;
+			}
+		}
+
+		if (m_resetRequested.exchange(false)) {
+			m_pSimulation->Reset();
+			m_timeStep.Reset();
+			Publish();
+		}
+
+		double now = Now();
+		float elapsed = (float)(now - last);
+		last = now;
+
+		// time spent paused isn't owed to the simulation afterwards
+		if (m_paused) {
+			m_timeStep.Reset();
+			std::this_thread::sleep_for(std::chrono::microseconds((long long)(m_timeStep.GetStepSize() * 1000000.0f)));
+			continue;
+		}
+
+		// however long it has been, the world moves in whole steps. A
+		// maxSubSteps of 0 steps the world by exactly one step
+		int steps = m_timeStep.BeginFrame(elapsed);
+		for (int i = 0; i < steps; i++)
+			m_pSimulation->UpdateScene(m_timeStep.GetStepSize(), 0);
+		double stepMilliseconds = (Now() - now) * 1000.0;
+
+		// only the adaptive mode needs to know how fast things are going
+		const TimeStepSettings &settings = m_timeStep.GetSettings();
+		m_timeStep.EndFrame(stepMilliseconds, settings.mode == TIMESTEP_ADAPTIVE ? m_pSimulation->GetMaxSafeStep() : 0.0f);
+		if (steps > 0) {
+			m_steps += steps;
+			Publish();
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_timeStepMutex);
+			m_stats = m_timeStep.GetStats();
+		}
+
+		// wait for the next step to be due. Whatever time the steps
+		// took counts towards it
+		double wait = now + m_timeStep.GetStepSize() * (1.0f - m_timeStep.GetAlpha()) - Now();
+		if (wait > 0.0)
+			std::this_thread::sleep_for(std::chrono::microseconds((long long)(wait * 1000000.0)));
+	}
+}
+
+void PhysicsThread::Capture(Snapshot &snapshot) {
+	const EntityStore &entities = m_pSimulation->GetEntities();
+	int count = entities.GetNumEntities();
+	snapshot.transforms.resize(count * FLOATS_PER_ENTITY);
+
+	btScalar* pOut = count ? &snapshot.transforms[0] : 0;
+	for (int i = 0; i < count; i++, pOut += FLOATS_PER_ENTITY) {
+		// the body's own transform is where the step left it
+		const btTransform &transform = entities.GetEntity(i).pBody->getWorldTransform();
+		const btVector3 &origin = transform.getOrigin();
+		btQuaternion rotation = transform.getRotation();
+		pOut[0] = origin.x();
+		pOut[1] = origin.y();
+		pOut[2] = origin.z();
+		pOut[3] = rotation.x();
+		pOut[4] = rotation.y();
+		pOut[5] = rotation.z();
+		pOut[6] = rotation.w();
+	}
+	snapshot.stamp = Now();
+	snapshot.step = m_timeStep.GetStepSize();
+}
+
+void PhysicsThread::Publish() {
+	Capture(m_snapshots[m_writeSlot]);
+
+	// swap the finished snapshot for whichever one the render thread
+	// last left behind
+	m_writeSlot = m_latest.exchange(m_writeSlot | FRESH) & SLOT_MASK;
+}
+
+void PhysicsThread::Interpolate() {
+	// take the newest snapshot if there is one, giving back the oldest
+	// of the two held. The newest always becomes current and the one
+	// it replaces becomes previous
+	if (m_latest.load() & FRESH) {
+		int fresh = m_latest.exchange(m_previousSlot) & SLOT_MASK;
+		m_previousSlot = m_currentSlot;
+		m_currentSlot = fresh;
+	}
+
+	const Snapshot &previous = m_snapshots[m_previousSlot];
+	const Snapshot &current = m_snapshots[m_currentSlot];
+
+	// draw the world as it was a step ago, which falls between the two
+	// snapshots while the physics thread keeps up. If it falls behind,
+	// or interpolation is off, the newest snapshot is shown as it is
+	double target = Now() - current.step;
+	float span = (float)(current.stamp - previous.stamp);
+	float t = 1.0f;
+	if (span > 0.0f && m_interpolate) {
+		t = (float)(target - previous.stamp) / span;
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+	}
+
+	int count = m_matrices.size();
+	if (count == 0)
+		return;
+
+	// blend every pose first, then turn them all into matrices at once
+	const btScalar* pFrom = &previous.transforms[0];
+	const btScalar* pTo = &current.transforms[0];
+	btScalar* pPose = &m_poses[0];
+	for (int i = 0; i < count; i++, pFrom += FLOATS_PER_ENTITY, pTo += FLOATS_PER_ENTITY, pPose += POSE_FLOATS) {
+		pPose[0] = pFrom[0] + (pTo[0] - pFrom[0]) * t;
+		pPose[1] = pFrom[1] + (pTo[1] - pFrom[1]) * t;
+		pPose[2] = pFrom[2] + (pTo[2] - pFrom[2]) * t;
+		pPose[3] = 1.0f;
+
+		// a normalized lerp is close enough to a slerp over one step.
+		// q and -q are the same rotation, so blend towards whichever
+		// is nearer. The conversion does the normalizing
+		btScalar sign = pFrom[3] * pTo[3] + pFrom[4] * pTo[4] + pFrom[5] * pTo[5] + pFrom[6] * pTo[6] < 0 ? -1.0f : 1.0f;
+		pPose[4] = pFrom[3] + (pTo[3] * sign - pFrom[3]) * t;
+		pPose[5] = pFrom[4] + (pTo[4] * sign - pFrom[4]) * t;
+		pPose[6] = pFrom[5] + (pTo[5] * sign - pFrom[5]) * t;
+		pPose[7] = pFrom[6] + (pTo[6] * sign - pFrom[6]) * t;
+	}
+	PosesToMatrices(&m_poses[0], count, &m_matrices[0]);
+}
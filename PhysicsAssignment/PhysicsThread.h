@@ -0,0 +1,125 @@
+#ifndef _PHYSICSTHREAD_H_
+#define _PHYSICSTHREAD_H_
+
+#include "btBulletDynamicsCommon.h"
+
+#include "MatrixBatch.h"
+#include "PhysicsSimulation.h"
+#include "TimeStepController.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// steps a simulation on its own thread, so a slow step holds up the
+// next step rather than the next frame. The thread's clock is turned
+// into steps by a TimeStepController, just as the frame loop's is when
+// there is no thread, so the same step, sub-step limit and adaptive
+// mode apply either way. After every batch of steps the bodies'
+// transforms are copied into a snapshot and published. The render
+// thread takes the two newest snapshots and draws the bodies part way
+// between them, a step behind real time, so motion stays smooth whether
+// the frame rate is above or below the step rate.
+//
+// snapshots are handed over without locks. There are four: the one
+// being written, the newest published one, and the two the render
+// thread is reading. Publishing and taking are each a single atomic
+// exchange of slot indices, so neither thread ever waits for the other
+//
+// while the thread runs it owns the world. The render thread only reads
+// what never changes after Initialize(), such as each entity's shape and
+// color, and gets transforms from here instead of from the bodies.
+// Changed time step settings and the controller's stats go through a
+// mutex, which is only held to copy them
+class PhysicsThread {
+public:
+	PhysicsThread();
+	~PhysicsThread();
+
+	// start stepping the simulation in real time, as settings says
+	void Start(PhysicsSimulation* pSimulation, const TimeStepSettings &settings = TimeStepSettings());
+
+	// finish the current step and stop
+	void Stop();
+
+	bool IsRunning() const { return m_thread.joinable(); }
+
+	// carried out by the physics thread before its next step
+	void RequestReset() { m_resetRequested = true; }
+	void SetPaused(bool paused) { m_paused = paused; }
+	bool IsPaused() const { return m_paused; }
+	void SetTimeStep(const TimeStepSettings &settings);
+
+	// the physics thread's step counts and load so far
+	TimeStepStats GetTimeStepStats();
+
+	// take the newest snapshots and work out every entity's matrix for
+	// now. Render thread only
+	void Interpolate();
+
+	// entity i's interpolated OpenGL matrix, as of the last Interpolate()
+	const btScalar* GetMatrix(int i) const { return m_matrices[i].m; }
+
+	// steps taken so far
+	unsigned int GetNumSteps() const { return m_steps; }
+
+private:
+	// every entity's position and rotation after a batch of steps
+	struct Snapshot {
+		std::vector<btScalar> transforms;	// x, y, z, then a quaternion's x, y, z, w
+		double stamp;						// when it was published, by Now()
+		float step;							// the size of the steps taken
+	};
+
+	enum {
+		NUM_SNAPSHOTS = 4,
+		FRESH = 4,				// set on m_latest when it hasn't been taken yet
+		SLOT_MASK = 3,
+		FLOATS_PER_ENTITY = 7
+	};
+
+	void Run();
+	void Capture(Snapshot &snapshot);
+	void Publish();
+
+	// seconds since Start(), for both threads. btClock only reads the
+	// performance counter, where the standard library's clocks on
+	// VS2013 tick every millisecond or more and would make the
+	// interpolation jump
+	double Now() { return m_clock.getTimeMicroseconds() / 1000000.0; }
+
+	PhysicsSimulation* m_pSimulation;
+	btClock m_clock;
+
+	// physics thread only, once started
+	TimeStepController m_timeStep;
+
+	std::thread m_thread;
+	std::atomic<bool> m_stopRequested;
+	std::atomic<bool> m_resetRequested;
+	std::atomic<bool> m_paused;
+	std::atomic<bool> m_interpolate;
+	std::atomic<unsigned int> m_steps;
+
+	// settings waiting to be taken up by the physics thread, and the
+	// stats it last left
+	std::mutex m_timeStepMutex;
+	TimeStepSettings m_newSettings;
+	bool m_settingsChanged;
+	TimeStepStats m_stats;
+
+	Snapshot m_snapshots[NUM_SNAPSHOTS];
+	int m_writeSlot;			// physics thread only
+	std::atomic<int> m_latest;	// the newest published slot, and FRESH
+	int m_previousSlot;			// render thread only
+	int m_currentSlot;			// render thread only
+
+	// the render thread's blended poses, POSE_FLOATS per entity, and the
+	// matrices they are turned into, one per entity
+	btAlignedObjectArray<btScalar> m_poses;
+	btAlignedObjectArray<OpenGLMatrix> m_matrices;
+};
+
+#endif
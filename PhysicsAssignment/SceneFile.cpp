@@ -0,0 +1,191 @@
+#include "SceneFile.h"
+
+#include <cstdio>
+#include <cstring>
+
+// the records are read in place, so their layout is part of the format
+static_assert(sizeof(SceneFileHeader) == 48, "scene file header layout changed");
+static_assert(sizeof(SceneShapeRecord) == 16, "scene shape record layout changed");
+static_assert(sizeof(SceneBodyRecord) == 40, "scene body record layout changed");
+
+static const char SCENE_FILE_MAGIC[4] = { 'D', 'O', 'M', 'S' };
+
+SceneFile::SceneFile()
+:
+m_pHeader(0),
+m_pShapes(0),
+m_pBodies(0),
+m_pLeads(0),
+m_numDominos(0)
+{
+}
+
+bool SceneFile::Open(const char* path) {
+	Close();
+
+	if (!m_file.Open(path)) {
+		printf("could not open scene file '%s'\n", path);
+		return false;
+	}
+
+	const unsigned char* pData = m_file.GetData();
+	size_t size = m_file.GetSize();
+
+	if (size < sizeof(SceneFileHeader) || memcmp(pData, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC)) != 0) {
+		printf("'%s' is not a scene file\n", path);
+		Close();
+		return false;
+	}
+
+	const SceneFileHeader* pHeader = reinterpret_cast<const SceneFileHeader*>(pData);
+	if (pHeader->version != SCENE_FILE_VERSION) {
+		printf("'%s' is scene file version %u, expected %u\n", path, pHeader->version, SCENE_FILE_VERSION);
+		Close();
+		return false;
+	}
+
+	// work the sizes out in 64 bits, so a corrupt count can't wrap around
+	unsigned long long expected = sizeof(SceneFileHeader)
+		+ (unsigned long long)pHeader->numShapes * sizeof(SceneShapeRecord)
+		+ (unsigned long long)pHeader->numBodies * sizeof(SceneBodyRecord)
+		+ (unsigned long long)pHeader->numLeads * sizeof(uint32_t);
+	if (size < expected || pHeader->numDominos > pHeader->numBodies) {
+		printf("scene file '%s' is truncated or corrupt\n", path);
+		Close();
+		return false;
+	}
+
+	m_pHeader = pHeader;
+	m_pShapes = reinterpret_cast<const SceneShapeRecord*>(pData + sizeof(SceneFileHeader));
+	m_pBodies = reinterpret_cast<const SceneBodyRecord*>(m_pShapes + pHeader->numShapes);
+	m_pLeads = reinterpret_cast<const uint32_t*>(m_pBodies + pHeader->numBodies);
+
+	// the simulation indexes its dominos by the header's count and the
+	// leads, so both have to match the dominos that will really be built
+	unsigned int numDominos = 0;
+	for (unsigned int i = 0; i < pHeader->numBodies; i++) {
+		if (!(m_pBodies[i].flags & SCENE_BODY_DOMINO))
+			continue;
+		if (!IsShapeKnown(m_pBodies[i].shape)) {
+			printf("scene file '%s' has a domino with an unknown shape\n", path);
+			Close();
+			return false;
+		}
+		numDominos++;
+	}
+	if (numDominos != pHeader->numDominos) {
+		printf("scene file '%s' says it has %u dominos but holds %u\n", path, pHeader->numDominos, numDominos);
+		Close();
+		return false;
+	}
+	for (unsigned int i = 0; i < pHeader->numLeads; i++) {
+		if (m_pLeads[i] >= numDominos) {
+			printf("scene file '%s' starts a chain at domino %u of %u\n", path, m_pLeads[i], numDominos);
+			Close();
+			return false;
+		}
+	}
+	m_numDominos = (int)numDominos;
+	return true;
+}
+
+bool SceneFile::IsShapeKnown(unsigned int shape) const {
+	if (shape >= m_pHeader->numShapes)
+		return false;
+	uint32_t type = m_pShapes[shape].type;
+	return type == SCENE_SHAPE_BOX || type == SCENE_SHAPE_CYLINDER;
+}
+
+void SceneFile::Close() {
+	m_file.Close();
+	m_pHeader = 0;
+	m_pShapes = 0;
+	m_pBodies = 0;
+	m_pLeads = 0;
+	m_numDominos = 0;
+}
+
+static void SetColor(uint8_t* color, float r, float g, float b) {
+	color[0] = (uint8_t)(r * 255.0f + 0.5f);
+	color[1] = (uint8_t)(g * 255.0f + 0.5f);
+	color[2] = (uint8_t)(b * 255.0f + 0.5f);
+	color[3] = 0;
+}
+
+static void SetBody(SceneBodyRecord &body, const btVector3 &position, const btQuaternion &orientation, int shape, int flags, float mass) {
+	body.position[0] = position.x();
+	body.position[1] = position.y();
+	body.position[2] = position.z();
+	body.orientation[0] = orientation.x();
+	body.orientation[1] = orientation.y();
+	body.orientation[2] = orientation.z();
+	body.orientation[3] = orientation.w();
+	body.shape = (uint16_t)shape;
+	body.flags = (uint16_t)flags;
+	body.mass = mass;
+}
+
+bool WriteSceneFile(const char* path, const DominoLayout &layout) {
+	FILE* pFile = fopen(path, "wb");
+	if (!pFile)
+		return false;
+
+	SceneFileHeader header;
+	memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC));
+	header.version = SCENE_FILE_VERSION;
+	header.numShapes = 2;
+	header.numBodies = (uint32_t)layout.placements.size() + 1;
+	header.numDominos = (uint32_t)layout.placements.size();
+	header.numLeads = (uint32_t)layout.leads.size();
+	for (int i = 0; i < 3; i++) {
+		header.boundsMin[i] = layout.boundsMin[i];
+		header.boundsMax[i] = layout.boundsMax[i];
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, pFile) == 1;
+
+	// shape 0 is the ground, shape 1 every domino
+	btVector3 groundCentre, groundHalfExtents;
+	layout.GetGround(groundCentre, groundHalfExtents);
+
+	SceneShapeRecord shapes[2];
+	shapes[0].type = SCENE_SHAPE_BOX;
+	shapes[1].type = SCENE_SHAPE_BOX;
+	for (int i = 0; i < 3; i++) {
+		shapes[0].halfExtents[i] = groundHalfExtents[i];
+		shapes[1].halfExtents[i] = DOMINO_HALF_EXTENTS[i];
+	}
+	ok = ok && fwrite(shapes, sizeof(shapes), 1, pFile) == 1;
+
+	// the ground isn't a domino, so it goes first and is left out of
+	// the toppling order. It keeps the default object rotation
+	SceneBodyRecord ground;
+	SetBody(ground, groundCentre, btQuaternion(0,0,1,1).normalized(), 0, 0, 0.0f);
+	SetColor(ground.color, 0.2f, 0.6f, 0.6f);
+	ok = ok && fwrite(&ground, sizeof(ground), 1, pFile) == 1;
+
+	// write the dominos a block at a time rather than one record per call
+	const int BLOCK = 4096;
+	SceneBodyRecord* pBlock = new SceneBodyRecord[BLOCK];
+	for (int first = 0; ok && first < layout.placements.size(); first += BLOCK) {
+		int count = (int)layout.placements.size() - first;
+		if (count > BLOCK)
+			count = BLOCK;
+
+		for (int i = 0; i < count; i++) {
+			const DominoPlacement &placement = layout.placements[first + i];
+			SetBody(pBlock[i], placement.position, placement.orientation, 1, SCENE_BODY_DOMINO, DOMINO_MASS);
+			SetColor(pBlock[i].color, 1.0f, 0.2f, 0.2f);
+		}
+		ok = fwrite(pBlock, sizeof(SceneBodyRecord), count, pFile) == (size_t)count;
+	}
+	delete [] pBlock;
+
+	for (int i = 0; ok && i < layout.leads.size(); i++) {
+		uint32_t lead = (uint32_t)layout.leads[i];
+		ok = fwrite(&lead, sizeof(lead), 1, pFile) == 1;
+	}
+
+	if (fclose(pFile) != 0)
+		ok = false;
+	return ok;
+}
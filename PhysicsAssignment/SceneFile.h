@@ -0,0 +1,100 @@
+#ifndef _SCENEFILE_H_
+#define _SCENEFILE_H_
+
+#include "btBulletDynamicsCommon.h"
+
+#include "MappedFile.h"
+#include "DominoLayout.h"
+
+#include <stdint.h>
+
+// a scene saved as a flat binary file. The file is a header, then a
+// table of shapes, a packed array of bodies and the lead dominos:
+//
+//   SceneFileHeader
+//   SceneShapeRecord[numShapes]
+//   SceneBodyRecord[numBodies]		every body, with the dominos among them in toppling order
+//   uint32_t[numLeads]			index of each chain's first domino among the dominos
+//
+// every record is a multiple of 4 bytes with no padding, and the file
+// is little endian, so it can be mapped and read in place
+
+#define SCENE_FILE_VERSION 1
+
+enum SceneShapeType {
+	SCENE_SHAPE_BOX,
+	SCENE_SHAPE_CYLINDER
+};
+
+enum SceneBodyFlags {
+	SCENE_BODY_DOMINO = 1		// part of the toppling order
+};
+
+struct SceneFileHeader {
+	char magic[4];				// "DOMS"
+	uint32_t version;
+	uint32_t numShapes;
+	uint32_t numBodies;
+	uint32_t numDominos;		// how many bodies have SCENE_BODY_DOMINO set
+	uint32_t numLeads;
+	float boundsMin[3];			// of every domino's position
+	float boundsMax[3];
+};
+
+struct SceneShapeRecord {
+	uint32_t type;				// a SceneShapeType
+	float halfExtents[3];
+};
+
+struct SceneBodyRecord {
+	float position[3];
+	float orientation[4];		// x, y, z, w
+	uint16_t shape;				// index into the shape table
+	uint16_t flags;				// SceneBodyFlags
+	float mass;					// 0 for static bodies
+	uint8_t color[4];			// r, g, b and an unused pad byte
+};
+
+// a scene file mapped into memory. Open() checks the header, that the
+// file is big enough for the tables it claims to hold, that it has as
+// many dominos as it says, each with a shape that can be built, and that
+// every lead is one of them. After that the tables are read straight out
+// of the mapping
+class SceneFile {
+public:
+	SceneFile();
+
+	// map and check the file. Prints why and returns false if it isn't
+	// a scene file this code can read
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return m_pHeader != 0; }
+
+	const SceneFileHeader& GetHeader() const { return *m_pHeader; }
+	const SceneShapeRecord* GetShapes() const { return m_pShapes; }
+	const SceneBodyRecord* GetBodies() const { return m_pBodies; }
+	const uint32_t* GetLeads() const { return m_pLeads; }
+
+	// the dominos the scene will be built with, counted from the body
+	// records rather than taken from the header
+	int GetNumDominos() const { return m_numDominos; }
+
+	// whether shape is in the table and of a type bodies can be built
+	// from. Bodies with other shapes are left out of the scene
+	bool IsShapeKnown(unsigned int shape) const;
+
+private:
+	MappedFile m_file;
+	const SceneFileHeader* m_pHeader;
+	const SceneShapeRecord* m_pShapes;
+	const SceneBodyRecord* m_pBodies;
+	const uint32_t* m_pLeads;
+	int m_numDominos;
+};
+
+// save a generated layout, with a ground box sized to fit it, as a
+// scene file. Returns false if the file can't be written
+bool WriteSceneFile(const char* path, const DominoLayout &layout);
+
+#endif
@@ -0,0 +1,74 @@
+#include "SceneSimulation.h"
+
+#include <cstdio>
+
+SceneSimulation::SceneSimulation(const SceneFile &scene)
+:
+m_scene(scene)
+{
+	const SceneFileHeader &header = m_scene.GetHeader();
+	m_leads.reserve(header.numLeads);
+	for (unsigned int i = 0; i < header.numLeads; i++)
+		m_leads.push_back((int)m_scene.GetLeads()[i]);
+}
+
+void SceneSimulation::CreateObjects() {
+	const SceneFileHeader &header = m_scene.GetHeader();
+
+	// one reference to each shape in the table, for the bodies to share
+	std::vector<btCollisionShape*> shapes(header.numShapes);
+	for (unsigned int i = 0; i < header.numShapes; i++) {
+		const SceneShapeRecord &record = m_scene.GetShapes()[i];
+		btVector3 halfExtents(record.halfExtents[0], record.halfExtents[1], record.halfExtents[2]);
+		if (record.type == SCENE_SHAPE_BOX)
+			shapes[i] = m_shapes.AcquireBox(halfExtents);
+		else if (record.type == SCENE_SHAPE_CYLINDER)
+			shapes[i] = m_shapes.AcquireCylinder(halfExtents);
+		else
+			shapes[i] = 0;
+	}
+
+	// size everything for the whole scene before the first body goes in
+	ReserveEntities(header.numBodies);
+	dominos.reserve(header.numDominos);
+
+	const SceneBodyRecord* pBodies = m_scene.GetBodies();
+	int skipped = 0;
+	for (unsigned int i = 0; i < header.numBodies; i++) {
+		const SceneBodyRecord &record = pBodies[i];
+		if (!m_scene.IsShapeKnown(record.shape)) {
+			skipped++;
+			continue;
+		}
+
+		EntityDesc desc;
+		desc.kind = (record.flags & SCENE_BODY_DOMINO) ? ENTITY_DOMINO : ENTITY_OBJECT;
+		desc.pShape = m_shapes.Retain(shapes[record.shape]);
+		desc.mass = record.mass;
+		desc.color = btVector3(record.color[0], record.color[1], record.color[2]) / 255.0f;
+		desc.position = btVector3(record.position[0], record.position[1], record.position[2]);
+
+		// the file holds the body's real orientation, so a
+		// rotated domino falls the way it is drawn facing. It is
+		// only floats, though, so it is made a unit rotation first
+		btQuaternion orientation(record.orientation[0], record.orientation[1], record.orientation[2], record.orientation[3]);
+		desc.orientation = orientation.length2() > SIMD_EPSILON ? orientation.normalized() : btQuaternion::getIdentity();
+		AddEntity(desc);
+	}
+
+	// the bodies hold their own references now
+	for (unsigned int i = 0; i < header.numShapes; i++)
+		m_shapes.Release(shapes[i]);
+
+	// SceneFile::Open() turns away dominos with unknown shapes, so
+	// these are only ever other bodies
+	if (skipped)
+		printf("skipped %d bodies with unknown shapes\n", skipped);
+}
+
+void SceneSimulation::GetSceneBounds(btVector3 &boundsMin, btVector3 &boundsMax) const {
+	// the file only bounds the dominos, which stand on the ground
+	const SceneFileHeader &header = m_scene.GetHeader();
+	boundsMin = btVector3(header.boundsMin[0], -1.0f, header.boundsMin[2]);
+	boundsMax = btVector3(header.boundsMax[0], header.boundsMax[1] + DOMINO_STANDING_HEIGHT, header.boundsMax[2]);
+}
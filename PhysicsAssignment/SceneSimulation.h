@@ -0,0 +1,25 @@
+#ifndef _SCENESIMULATION_H_
+#define _SCENESIMULATION_H_
+
+#include "PhysicsSimulation.h"
+#include "SceneFile.h"
+
+// a simulation whose scene, ground included, is streamed straight out
+// of a mapped scene file. The file has to stay open for as long as the
+// simulation might rebuild its objects
+class SceneSimulation : public PhysicsSimulation {
+public:
+	SceneSimulation(const SceneFile &scene);
+
+	// the ground is one of the file's bodies
+	virtual void CreateGround() {}
+	virtual void CreateObjects();
+
+	virtual void GetSceneBounds(btVector3 &boundsMin, btVector3 &boundsMax) const;
+	virtual int GetExpectedBodies() const { return (int)m_scene.GetHeader().numBodies; }
+
+protected:
+	const SceneFile &m_scene;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "ShapeRegistry.h"
+
+bool ShapeRegistry::ShapeKey::operator<(const ShapeKey &other) const {
+	if (shapeType != other.shapeType)
+		return shapeType < other.shapeType;
+	for (int i = 0; i < 3; i++) {
+		if (dimensions[i] != other.dimensions[i])
+			return dimensions[i] < other.dimensions[i];
+	}
+	return false;
+}
+
+ShapeRegistry::ShapeRegistry() {
+}
+
+ShapeRegistry::~ShapeRegistry() {
+	// anything still referenced goes with the registry
+	for (int i = 0; i < m_entries.size(); i++)
+		delete m_entries[i].pShape;
+}
+
+btCollisionShape* ShapeRegistry::AcquireBox(const btVector3 &halfExtents) {
+	return Acquire(BOX_SHAPE_PROXYTYPE, halfExtents);
+}
+
+btCollisionShape* ShapeRegistry::AcquireCylinder(const btVector3 &halfExtents) {
+	return Acquire(CYLINDER_SHAPE_PROXYTYPE, halfExtents);
+}
+
+btCollisionShape* ShapeRegistry::Acquire(int shapeType, const btVector3 &dimensions) {
+	ShapeKey key;
+	key.shapeType = shapeType;
+	key.dimensions[0] = dimensions.x();
+	key.dimensions[1] = dimensions.y();
+	key.dimensions[2] = dimensions.z();
+
+	// already made one of these, so share it
+	std::map<ShapeKey, int>::iterator it = m_lookup.find(key);
+	if (it != m_lookup.end()) {
+		Entry &entry = m_entries[it->second];
+		entry.references++;
+		return entry.pShape;
+	}
+
+	Entry entry;
+	entry.references = 1;
+	entry.key = key;
+	switch (shapeType) {
+	case BOX_SHAPE_PROXYTYPE:
+		entry.pShape = new btBoxShape(dimensions);
+		entry.size = sizeof(btBoxShape);
+		break;
+	case CYLINDER_SHAPE_PROXYTYPE:
+		entry.pShape = new btCylinderShape(dimensions);
+		entry.size = sizeof(btCylinderShape);
+		break;
+	default:
+		return 0;
+	}
+
+	// inertia scales linearly with mass, so one call covers every mass
+	entry.unitInertia = btVector3(0,0,0);
+	entry.pShape->calculateLocalInertia(1.0f, entry.unitInertia);
+
+	// reuse a released slot if there is one
+	int index;
+	if (!m_freeEntries.empty()) {
+		index = m_freeEntries.back();
+		m_freeEntries.pop_back();
+		m_entries[index] = entry;
+	} else {
+		index = (int)m_entries.size();
+		m_entries.push_back(entry);
+	}
+
+	entry.pShape->setUserIndex(index);
+	m_lookup[key] = index;
+	return entry.pShape;
+}
+
+btCollisionShape* ShapeRegistry::Retain(btCollisionShape* pShape) {
+	if (!pShape)
+		return 0;
+
+	int index = pShape->getUserIndex();
+	btAssert(index >= 0 && index < m_entries.size() && m_entries[index].pShape == pShape);
+	m_entries[index].references++;
+	return pShape;
+}
+
+void ShapeRegistry::Release(btCollisionShape* pShape) {
+	if (!pShape)
+		return;
+
+	int index = pShape->getUserIndex();
+	btAssert(index >= 0 && index < m_entries.size() && m_entries[index].pShape == pShape);
+
+	Entry &entry = m_entries[index];
+	if (--entry.references > 0)
+		return;
+
+	// the last user is gone
+	m_lookup.erase(entry.key);
+	delete entry.pShape;
+	entry.pShape = 0;
+	m_freeEntries.push_back(index);
+}
+
+btVector3 ShapeRegistry::GetLocalInertia(const btCollisionShape* pShape, btScalar mass) const {
+	// objects of infinite mass can't move or rotate
+	if (mass == 0.0f || !pShape)
+		return btVector3(0,0,0);
+
+	return m_entries[pShape->getUserIndex()].unitInertia * mass;
+}
+
+ShapeRegistryStats ShapeRegistry::GetStats() const {
+	ShapeRegistryStats stats;
+	for (int i = 0; i < m_entries.size(); i++) {
+		const Entry &entry = m_entries[i];
+		if (!entry.pShape)
+			continue;
+
+		stats.uniqueShapes++;
+		stats.references += entry.references;
+		stats.bytesUsed += entry.size;
+		stats.bytesSaved += (entry.references - 1) * entry.size;
+	}
+	return stats;
+}
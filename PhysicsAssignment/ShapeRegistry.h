@@ -0,0 +1,74 @@
+#ifndef _SHAPEREGISTRY_H_
+#define _SHAPEREGISTRY_H_
+
+#include "btBulletDynamicsCommon.h"
+
+#include <map>
+#include <vector>
+
+// counters describing how much sharing the registry is doing
+struct ShapeRegistryStats {
+	int uniqueShapes;	// shapes actually allocated
+	int references;		// shapes handed out and not yet released
+	size_t bytesUsed;	// memory held by the allocated shapes
+	size_t bytesSaved;	// memory that one shape per reference would have cost on top
+
+	ShapeRegistryStats() : uniqueShapes(0), references(0), bytesUsed(0), bytesSaved(0) {}
+};
+
+// hands out shared, reference counted collision shapes. Asking twice
+// for a box with the same half extents returns the same btBoxShape, so
+// a million identical dominos cost one shape instead of a million. The
+// unit-mass inertia of every shape is worked out once and cached too
+class ShapeRegistry {
+public:
+	ShapeRegistry();
+	~ShapeRegistry();
+
+	// get a shared shape, creating it the first time it is asked
+	// for. Every Acquire must be matched by a Release
+	btCollisionShape* AcquireBox(const btVector3 &halfExtents);
+	btCollisionShape* AcquireCylinder(const btVector3 &halfExtents);
+
+	// take another reference to a shape the registry handed out,
+	// without looking it up again. Also matched by a Release
+	btCollisionShape* Retain(btCollisionShape* pShape);
+
+	// give a shape back. It is deleted once nobody is using it
+	void Release(btCollisionShape* pShape);
+
+	// the shape's local inertia for the given mass. Box and cylinder
+	// inertia is linear in mass, so this is the cached unit-mass
+	// inertia scaled up, with no call into the shape
+	btVector3 GetLocalInertia(const btCollisionShape* pShape, btScalar mass) const;
+
+	ShapeRegistryStats GetStats() const;
+
+private:
+	// a shape's type and dimensions, which is everything that makes
+	// one box or cylinder different from another
+	struct ShapeKey {
+		int shapeType;
+		btScalar dimensions[3];
+
+		bool operator<(const ShapeKey &other) const;
+	};
+
+	struct Entry {
+		btCollisionShape* pShape;
+		int references;
+		btVector3 unitInertia;
+		size_t size;
+		ShapeKey key;
+	};
+
+	btCollisionShape* Acquire(int shapeType, const btVector3 &dimensions);
+
+	// entries are found by key when acquiring and by index (stored
+	// in the shape's user index) when releasing
+	std::map<ShapeKey, int> m_lookup;
+	std::vector<Entry> m_entries;
+	std::vector<int> m_freeEntries;
+};
+
+#endif
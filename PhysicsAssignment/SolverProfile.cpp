@@ -0,0 +1,82 @@
+#include "SolverProfile.h"
+
+#include "BulletDynamics/ConstraintSolver/btNNCGConstraintSolver.h"
+
+#include <cstring>
+
+static const char* s_profileNames[NUM_SOLVER_PROFILES] = {
+	"fast",
+	"balanced",
+	"accurate"
+};
+
+static const char* s_typeNames[NUM_SOLVER_TYPES] = {
+	"si",
+	"nncg"
+};
+
+SolverSettings GetSolverProfile(SolverProfile profile) {
+	SolverSettings settings;
+	switch (profile) {
+	case SOLVER_PROFILE_FAST:
+		// few iterations, leaning on warm starting to carry the solve
+		// over from one step to the next, stopping sooner still once
+		// nothing much is changing, and no position pass
+		settings.iterations = 4;
+		settings.splitImpulse = false;
+		settings.residualThreshold = 1e-4f;
+		break;
+	case SOLVER_PROFILE_ACCURATE:
+		// a solver that converges faster, given every iteration it
+		// asks for, and friction that holds a leaning domino in place
+		settings.type = SOLVER_NNCG;
+		settings.iterations = 30;
+		settings.twoFrictionDirections = true;
+		break;
+	default:
+		break;
+	}
+	return settings;
+}
+
+const char* GetSolverProfileName(SolverProfile profile) {
+	return profile >= 0 && profile < NUM_SOLVER_PROFILES ? s_profileNames[profile] : "unknown";
+}
+
+bool ParseSolverProfileName(const char* name, SolverProfile &profile) {
+	for (int i = 0; i < NUM_SOLVER_PROFILES; i++) {
+		if (strcmp(name, s_profileNames[i]) == 0) {
+			profile = (SolverProfile)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* GetSolverTypeName(SolverType type) {
+	return type >= 0 && type < NUM_SOLVER_TYPES ? s_typeNames[type] : "unknown";
+}
+
+btConstraintSolver* CreateSolver(SolverType type) {
+	if (type == SOLVER_NNCG)
+		return new btNNCGConstraintSolver();
+	return new btSequentialImpulseConstraintSolver();
+}
+
+// set or clear one of the solver mode's flags
+static void SetSolverMode(btContactSolverInfo &info, int flag, bool on) {
+	if (on)
+		info.m_solverMode |= flag;
+	else
+		info.m_solverMode &= ~flag;
+}
+
+void ApplySolverSettings(const SolverSettings &settings, btContactSolverInfo &info) {
+	info.m_numIterations = settings.iterations;
+	info.m_warmstartingFactor = settings.warmStartingFactor;
+	info.m_splitImpulse = settings.splitImpulse;
+	info.m_leastSquaresResidualThreshold = settings.residualThreshold;
+	SetSolverMode(info, SOLVER_USE_WARMSTARTING, settings.warmStarting);
+	SetSolverMode(info, SOLVER_SIMD, settings.simd);
+	SetSolverMode(info, SOLVER_USE_2_FRICTION_DIRECTIONS, settings.twoFrictionDirections);
+}
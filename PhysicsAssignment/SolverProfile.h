@@ -0,0 +1,65 @@
+#ifndef _SOLVERPROFILE_H_
+#define _SOLVERPROFILE_H_
+
+#include "btBulletDynamicsCommon.h"
+
+// the constraint solvers a simulation can be built with
+enum SolverType {
+	SOLVER_SEQUENTIAL_IMPULSE,	// Bullet's default projected Gauss-Seidel
+	SOLVER_NNCG,				// nonsmooth nonlinear conjugate gradient, which converges faster per iteration
+	NUM_SOLVER_TYPES
+};
+
+// named trade-offs between how fast a step is and how closely a chain
+// topples the way a fully converged solve would have it
+enum SolverProfile {
+	SOLVER_PROFILE_FAST,		// interactive previews
+	SOLVER_PROFILE_BALANCED,	// Bullet's defaults
+	SOLVER_PROFILE_ACCURATE,	// offline runs, and the reference the others are measured against
+	NUM_SOLVER_PROFILES
+};
+
+struct SolverSettings {
+	SolverType type;
+	int iterations;
+	// start each step from the impulses the contacts ended the last one
+	// with, scaled by warmStartingFactor. A standing chain's contacts
+	// barely change from step to step, so this is most of the accuracy
+	bool warmStarting;
+	btScalar warmStartingFactor;
+	// resolve penetration with a separate position pass, so pushing
+	// dominos apart doesn't add energy and make them bounce
+	bool splitImpulse;
+	// Bullet's SSE solver loops, when it was built with them
+	bool simd;
+	// a second friction direction per contact, so a domino resting on
+	// its neighbour doesn't slide sideways off it
+	bool twoFrictionDirections;
+	// stop iterating early once the solve changes less than this. 0
+	// always runs every iteration
+	btScalar residualThreshold;
+
+	// Bullet's own defaults, which the balanced profile is
+	SolverSettings() : type(SOLVER_SEQUENTIAL_IMPULSE), iterations(10), warmStarting(true), warmStartingFactor(0.85f),
+		splitImpulse(true), simd(true), twoFrictionDirections(false), residualThreshold(0.0f) {}
+};
+
+// the settings a profile stands for
+SolverSettings GetSolverProfile(SolverProfile profile);
+
+// "fast", "balanced" or "accurate"
+const char* GetSolverProfileName(SolverProfile profile);
+
+// the other way round. Returns false, leaving profile alone, if the name is unknown
+bool ParseSolverProfileName(const char* name, SolverProfile &profile);
+
+// "si" or "nncg"
+const char* GetSolverTypeName(SolverType type);
+
+// a new solver of the given type
+btConstraintSolver* CreateSolver(SolverType type);
+
+// write settings into the world's solver info
+void ApplySolverSettings(const SolverSettings &settings, btContactSolverInfo &info);
+
+#endif
@@ -0,0 +1,96 @@
+#include "TimeStepController.h"
+
+// the share of real time spent stepping past which the adaptive mode
+// takes longer steps, and below which it goes back to shorter ones
+#define ADAPT_LOAD_HIGH 0.8f
+#define ADAPT_LOAD_LOW 0.4f
+
+// how much the step changes by each frame it adapts
+#define ADAPT_FACTOR 1.25f
+
+// how much of each frame's load goes into the smoothed load
+#define LOAD_SMOOTHING 0.1f
+
+TimeStepController::TimeStepController()
+:
+m_accumulator(0.0f),
+m_stepsThisFrame(0),
+m_clampedThisFrame(false)
+{
+	SetSettings(TimeStepSettings());
+}
+
+void TimeStepController::SetSettings(const TimeStepSettings &settings) {
+	m_settings = settings;
+	if (m_settings.step <= 0.0f)
+		m_settings.step = TimeStepSettings().step;
+	if (m_settings.maxStep < m_settings.step)
+		m_settings.maxStep = m_settings.step;
+	if (m_settings.maxSubSteps < 1)
+		m_settings.maxSubSteps = 1;
+
+	m_step = m_settings.step;
+	m_nextStep = m_step;
+	m_accumulator = 0.0f;
+}
+
+int TimeStepController::BeginFrame(float frameTime) {
+	// the step only changes between frames, so the alpha always
+	// describes the steps just taken
+	m_step = m_nextStep;
+
+	if (frameTime < 0.0f)
+		frameTime = 0.0f;
+	else if (frameTime > m_settings.maxFrameTime)
+		frameTime = m_settings.maxFrameTime;
+
+	m_accumulator += frameTime;
+	int steps = (int)(m_accumulator / m_step);
+	m_accumulator -= steps * m_step;
+	if (m_accumulator < 0.0f)
+		m_accumulator = 0.0f;
+
+	// more due than can be taken, so let the simulation fall behind
+	// rather than spend ever longer catching up
+	m_clampedThisFrame = steps > m_settings.maxSubSteps;
+	if (m_clampedThisFrame) {
+		m_stats.droppedTime += (steps - m_settings.maxSubSteps) * m_step;
+		m_stats.clampedFrames++;
+		steps = m_settings.maxSubSteps;
+	}
+
+	m_stepsThisFrame = steps;
+	m_stats.frames++;
+	m_stats.steps += steps;
+	return steps;
+}
+
+void TimeStepController::EndFrame(double stepMilliseconds, float maxSafeStep) {
+	if (m_stepsThisFrame > 0) {
+		float load = (float)(stepMilliseconds / (m_stepsThisFrame * m_step * 1000.0));
+		m_stats.load += (load - m_stats.load) * LOAD_SMOOTHING;
+	}
+
+	if (m_settings.mode != TIMESTEP_ADAPTIVE) {
+		m_nextStep = m_settings.step;
+		return;
+	}
+
+	float next = m_step;
+	if (m_clampedThisFrame || m_stats.load > ADAPT_LOAD_HIGH)
+		next *= ADAPT_FACTOR;
+	else if (m_stats.load < ADAPT_LOAD_LOW)
+		next /= ADAPT_FACTOR;
+
+	// however far behind we are, never past what keeps the fastest
+	// body from passing through the thinnest, nor finer than asked for
+	float ceiling = m_settings.maxStep;
+	if (maxSafeStep > 0.0f && maxSafeStep < ceiling)
+		ceiling = maxSafeStep;
+	if (next > ceiling)
+		next = ceiling;
+	if (next < m_settings.step)
+		next = m_settings.step;
+
+	m_nextStep = next;
+}
@@ -0,0 +1,94 @@
+#ifndef _TIMESTEPCONTROLLER_H_
+#define _TIMESTEPCONTROLLER_H_
+
+// how the internal step is chosen
+enum TimeStepMode {
+	TIMESTEP_FIXED,		// always the configured step
+	TIMESTEP_ADAPTIVE	// coarser steps while stepping can't keep up, within what keeps thin bodies from tunneling
+};
+
+struct TimeStepSettings {
+	TimeStepMode mode;
+	float step;				// the internal step, and the finest the adaptive mode goes
+	float maxStep;			// the coarsest step the adaptive mode may take
+	int maxSubSteps;		// the most steps taken in one frame. Time beyond them is dropped
+	float maxFrameTime;		// frames longer than this, such as after a breakpoint, count as this long
+	bool interpolate;		// draw bodies between their last two steps rather than at the latest
+
+	TimeStepSettings()
+	:
+	mode(TIMESTEP_FIXED),
+	step(1.0f / 60.0f),
+	maxStep(1.0f / 30.0f),
+	maxSubSteps(5),
+	maxFrameTime(0.25f),
+	interpolate(true)
+	{
+	}
+};
+
+struct TimeStepStats {
+	unsigned int frames;
+	unsigned int steps;
+	unsigned int clampedFrames;	// frames that had more steps due than maxSubSteps allows
+	double droppedTime;			// simulated seconds given up to keep up
+	float load;					// time spent stepping as a fraction of the time simulated, smoothed
+
+	TimeStepStats() : frames(0), steps(0), clampedFrames(0), droppedTime(0.0), load(0.0f) {}
+};
+
+// turns the wall clock time between frames into a whole number of fixed
+// steps, so the simulation comes out the same whatever the frame rate.
+// The time left over, less than one step, is carried into the next frame
+// and reported as an alpha for the renderer to draw part way between the
+// last two steps with.
+//
+// a frame is never allowed more than maxSubSteps steps. Past that,
+// stepping takes longer than the time it simulates and every frame would
+// have more to catch up on than the last, so the extra time is dropped
+// and the simulation runs slower than real time instead.
+//
+// in the adaptive mode, a frame that needed clamping or that spent most
+// of its time stepping makes the next frame's step longer, and spare
+// time brings it back down towards the configured step. The step is
+// never allowed past the longest one that still keeps the fastest body
+// from moving through the thinnest one, which the caller works out
+class TimeStepController {
+public:
+	TimeStepController();
+
+	void SetSettings(const TimeStepSettings &settings);
+	const TimeStepSettings& GetSettings() const { return m_settings; }
+
+	// add a frame's wall clock time. Returns how many steps of
+	// GetStepSize() to take this frame
+	int BeginFrame(float frameTime);
+
+	// how long this frame's steps took, and the longest step that is
+	// still safe from tunneling, or 0 for no limit. Only the adaptive
+	// mode uses the limit, to pick the next frame's step
+	void EndFrame(double stepMilliseconds, float maxSafeStep);
+
+	// the step to take this frame
+	float GetStepSize() const { return m_step; }
+
+	// how far between the last two steps now is, from 0 to 1
+	float GetAlpha() const { return m_accumulator / m_step; }
+
+	// forget the time carried over, such as after a reset or a pause
+	void Reset() { m_accumulator = 0.0f; }
+
+	const TimeStepStats& GetStats() const { return m_stats; }
+
+private:
+	TimeStepSettings m_settings;
+	TimeStepStats m_stats;
+
+	float m_step;
+	float m_nextStep;		// the adaptive mode's choice for the next frame
+	float m_accumulator;	// time not yet stepped, always less than m_step
+	int m_stepsThisFrame;
+	bool m_clampedThisFrame;
+};
+
+#endif
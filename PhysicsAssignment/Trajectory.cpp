@@ -0,0 +1,419 @@
+#include "Trajectory.h"
+
+#include <cmath>
+#include <cstring>
+
+// the header is read in place, so its layout is part of the format
+static_assert(sizeof(TrajectoryHeader) == 32, "trajectory header layout changed");
+static_assert(sizeof(TrajectoryFrameHeader) == 12, "trajectory frame header layout changed");
+
+static const char TRAJECTORY_MAGIC[4] = { 'D', 'O', 'M', 'T' };
+
+// the three smallest components of a unit quaternion all lie within
+// +-1/sqrt(2), so that range is spread over the whole of an int16
+static const float ROTATION_SCALE = 32767.0f * 1.41421356f;
+
+// the most bytes one body record can take: a five byte varint, the
+// flags, an absolute position and the rotation
+static const int MAX_RECORD_SIZE = 5 + 1 + 3 * 4 + 3 * 2;
+
+bool TrajectoryBodyState::operator==(const TrajectoryBodyState &other) const {
+	return position[0] == other.position[0] && position[1] == other.position[1] && position[2] == other.position[2]
+		&& rotation[0] == other.rotation[0] && rotation[1] == other.rotation[1] && rotation[2] == other.rotation[2]
+		&& largest == other.largest;
+}
+
+static int16_t QuantizeRotation(float value) {
+	float scaled = floorf(value * ROTATION_SCALE + 0.5f);
+	if (scaled > 32767.0f) scaled = 32767.0f;
+	if (scaled < -32767.0f) scaled = -32767.0f;
+	return (int16_t)scaled;
+}
+
+static void Quantize(const btTransform &transform, float invPositionScale, TrajectoryBodyState &state) {
+	const btVector3 &origin = transform.getOrigin();
+	for (int i = 0; i < 3; i++)
+		state.position[i] = (int32_t)floor(origin[i] * invPositionScale + 0.5f);
+
+	// drop the largest component, flipping the quaternion so it is
+	// positive. q and -q are the same rotation
+	btQuaternion rotation = transform.getRotation();
+	float components[4] = { rotation.x(), rotation.y(), rotation.z(), rotation.w() };
+	int largest = 0;
+	for (int i = 1; i < 4; i++) {
+		if (fabsf(components[i]) > fabsf(components[largest]))
+			largest = i;
+	}
+	float sign = components[largest] < 0.0f ? -1.0f : 1.0f;
+	for (int i = 0, j = 0; i < 4; i++) {
+		if (i != largest)
+			state.rotation[j++] = QuantizeRotation(components[i] * sign);
+	}
+	state.largest = (uint8_t)largest;
+}
+
+static void Dequantize(const TrajectoryBodyState &state, float positionScale, btTransform &transform) {
+	transform.setOrigin(btVector3(state.position[0] * positionScale, state.position[1] * positionScale, state.position[2] * positionScale));
+
+	// the dropped component is whatever makes the quaternion unit length
+	float components[4];
+	float sum = 0.0f;
+	for (int i = 0, j = 0; i < 4; i++) {
+		if (i == state.largest)
+			continue;
+		components[i] = state.rotation[j++] / ROTATION_SCALE;
+		sum += components[i] * components[i];
+	}
+	components[state.largest] = sqrtf(sum < 1.0f ? 1.0f - sum : 0.0f);
+	transform.setRotation(btQuaternion(components[0], components[1], components[2], components[3]));
+}
+
+static unsigned char* PutVarint(unsigned char* p, uint32_t value) {
+	while (value >= 0x80) {
+		*p++ = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	*p++ = (unsigned char)value;
+	return p;
+}
+
+static const unsigned char* GetVarint(const unsigned char* p, const unsigned char* end, uint32_t &value) {
+	value = 0;
+	for (int shift = 0; p < end && shift < 35; shift += 7) {
+		unsigned char byte = *p++;
+		value |= (uint32_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return p;
+	}
+	return 0;
+}
+
+TrajectoryRecorder::TrajectoryRecorder()
+:
+m_pFile(0),
+m_failed(false),
+m_forceKeyframe(false)
+{
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+TrajectoryRecorder::~TrajectoryRecorder() {
+	Close();
+}
+
+bool TrajectoryRecorder::Open(const char* path, const EntityStore &entities, int keyframeInterval, float positionScale) {
+	Close();
+
+	if (keyframeInterval < 1 || positionScale <= 0.0f)
+		return false;
+
+	m_pFile = fopen(path, "wb");
+	if (!m_pFile) {
+		printf("could not create recording '%s'\n", path);
+		return false;
+	}
+
+	memcpy(m_header.magic, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC));
+	m_header.version = TRAJECTORY_FILE_VERSION;
+	m_header.numBodies = (uint32_t)entities.GetNumEntities();
+	m_header.numFrames = 0;
+	m_header.keyframeInterval = (uint32_t)keyframeInterval;
+	m_header.stepSize = 0.0f;		// known once the first step is recorded
+	m_header.positionScale = positionScale;
+	m_header.reserved = 0;
+
+	m_stats = TrajectoryStats();
+	m_failed = fwrite(&m_header, sizeof(m_header), 1, m_pFile) != 1;
+	m_stats.bytes = sizeof(m_header);
+
+	// frame 0 is the scene before it has moved
+	m_states.resize(entities.GetNumEntities());
+	WriteFrame(entities, true);
+	return !m_failed;
+}
+
+bool TrajectoryRecorder::Close() {
+	if (!m_pFile)
+		return false;
+
+	// now the frame count and step size are known
+	m_header.numFrames = (uint32_t)m_stats.frames;
+	bool ok = !m_failed
+		&& fseek(m_pFile, 0, SEEK_SET) == 0
+		&& fwrite(&m_header, sizeof(m_header), 1, m_pFile) == 1;
+	if (fclose(m_pFile) != 0)
+		ok = false;
+
+	m_pFile = 0;
+	m_states.clear();
+	return ok;
+}
+
+void TrajectoryRecorder::RecordStep(const EntityStore &entities, btScalar timeStep) {
+	if (!m_pFile || m_failed)
+		return;
+
+	// the frames only line up with the entities while none are added
+	// or removed, so stop rather than record nonsense
+	if (entities.GetNumEntities() != (int)m_header.numBodies) {
+		printf("the scene changed while it was being recorded, so recording stopped\n");
+		m_failed = true;
+		return;
+	}
+
+	if (m_header.stepSize == 0.0f)
+		m_header.stepSize = timeStep;
+
+	WriteFrame(entities, m_stats.frames % m_header.keyframeInterval == 0);
+}
+
+void TrajectoryRecorder::ForceKeyframe() {
+	m_forceKeyframe = true;
+}
+
+void TrajectoryRecorder::WriteFrame(const EntityStore &entities, bool keyframe) {
+	keyframe = keyframe || m_forceKeyframe;
+	m_forceKeyframe = false;
+
+	int numEntities = entities.GetNumEntities();
+	float invPositionScale = 1.0f / m_header.positionScale;
+
+	// room for the frame header and every body, so the loop below
+	// writes through a plain pointer
+	m_buffer.resize(sizeof(TrajectoryFrameHeader) + numEntities * MAX_RECORD_SIZE);
+	unsigned char* pStart = &m_buffer[0];
+	unsigned char* p = pStart + sizeof(TrajectoryFrameHeader);
+
+	TrajectoryFrameHeader frame;
+	frame.numBodies = 0;
+	frame.flags = keyframe ? TRAJECTORY_KEYFRAME : 0;
+
+	int last = -1;
+	for (int i = 0; i < numEntities; i++) {
+		const btRigidBody* pBody = entities.GetEntity(i).pBody;
+
+		// a sleeping body hasn't moved, so it only needs quantizing
+		// when every body is being written
+		if (!keyframe && !pBody->isActive())
+			continue;
+
+		TrajectoryBodyState state;
+		Quantize(pBody->getWorldTransform(), invPositionScale, state);
+
+		TrajectoryBodyState &previous = m_states[i];
+		if (!keyframe && state == previous)
+			continue;
+
+		// a delta only fits if the body moved less than an int16's
+		// worth of steps along every axis
+		bool absolute = keyframe;
+		int32_t delta[3];
+		for (int j = 0; j < 3; j++) {
+			delta[j] = state.position[j] - previous.position[j];
+			if (delta[j] < -32768 || delta[j] > 32767)
+				absolute = true;
+		}
+
+		p = PutVarint(p, (uint32_t)(i - last - 1));
+		*p++ = (unsigned char)((absolute ? TRAJECTORY_ABSOLUTE : 0) | (state.largest << 1));
+		if (absolute) {
+			memcpy(p, state.position, sizeof(state.position));
+			p += sizeof(state.position);
+		} else {
+			for (int j = 0; j < 3; j++) {
+				int16_t value = (int16_t)delta[j];
+				memcpy(p, &value, sizeof(value));
+				p += sizeof(value);
+			}
+		}
+		memcpy(p, state.rotation, sizeof(state.rotation));
+		p += sizeof(state.rotation);
+
+		previous = state;
+		frame.numBodies++;
+		last = i;
+	}
+
+	frame.size = (uint32_t)(p - pStart - sizeof(TrajectoryFrameHeader));
+	memcpy(pStart, &frame, sizeof(frame));
+
+	size_t size = p - pStart;
+	if (fwrite(pStart, 1, size, m_pFile) != size) {
+		printf("could not write to the recording, so recording stopped\n");
+		m_failed = true;
+		return;
+	}
+
+	m_stats.frames++;
+	if (keyframe)
+		m_stats.keyframes++;
+	m_stats.bodyRecords += frame.numBodies;
+	m_stats.bytes += size;
+}
+
+TrajectoryPlayer::TrajectoryPlayer()
+:
+m_pHeader(0),
+m_time(0.0f),
+m_decodedFrame(-1),
+m_appliedFrame(-1)
+{
+}
+
+bool TrajectoryPlayer::Open(const char* path) {
+	Close();
+
+	if (!m_file.Open(path)) {
+		printf("could not open recording '%s'\n", path);
+		return false;
+	}
+
+	const unsigned char* pData = m_file.GetData();
+	size_t size = m_file.GetSize();
+
+	if (size < sizeof(TrajectoryHeader) || memcmp(pData, TRAJECTORY_MAGIC, sizeof(TRAJECTORY_MAGIC)) != 0) {
+		printf("'%s' is not a recording\n", path);
+		Close();
+		return false;
+	}
+
+	const TrajectoryHeader* pHeader = reinterpret_cast<const TrajectoryHeader*>(pData);
+	if (pHeader->version != TRAJECTORY_FILE_VERSION) {
+		printf("'%s' is recording version %u, expected %u\n", path, pHeader->version, TRAJECTORY_FILE_VERSION);
+		Close();
+		return false;
+	}
+
+	// index the frames. A recording that was never closed still plays,
+	// up to its last complete frame
+	size_t offset = sizeof(TrajectoryHeader);
+	while (size - offset >= sizeof(TrajectoryFrameHeader)) {
+		TrajectoryFrameHeader frame;
+		memcpy(&frame, pData + offset, sizeof(frame));
+		if (size - offset - sizeof(frame) < frame.size)
+			break;
+		m_frames.push_back(offset);
+		offset += sizeof(frame) + frame.size;
+	}
+
+	TrajectoryFrameHeader first;
+	if (!m_frames.empty())
+		memcpy(&first, pData + m_frames[0], sizeof(first));
+	if (m_frames.empty() || !(first.flags & TRAJECTORY_KEYFRAME) || pHeader->keyframeInterval < 1
+		|| pHeader->stepSize <= 0.0f || pHeader->positionScale <= 0.0f) {
+		printf("recording '%s' is truncated or corrupt\n", path);
+		Close();
+		return false;
+	}
+
+	m_pHeader = pHeader;
+	m_states.resize(pHeader->numBodies);
+	m_isChanged.assign(pHeader->numBodies, 0);
+	return true;
+}
+
+void TrajectoryPlayer::Close() {
+	m_file.Close();
+	m_pHeader = 0;
+	m_frames.clear();
+	m_states.clear();
+	m_changed.clear();
+	m_isChanged.clear();
+	m_time = 0.0f;
+	m_decodedFrame = -1;
+	m_appliedFrame = -1;
+}
+
+void TrajectoryPlayer::Seek(float time) {
+	float end = GetDuration() - GetStepSize();
+	m_time = time < 0.0f ? 0.0f : (time > end ? end : time);
+}
+
+bool TrajectoryPlayer::Apply(EntityStore &entities) {
+	if (entities.GetNumEntities() != GetNumBodies())
+		return false;
+
+	// a little slack so a time that is a whole number of steps, less
+	// rounding, doesn't land on the frame before
+	int target = (int)(m_time / GetStepSize() + 0.001f);
+	if (target >= GetNumFrames())
+		target = GetNumFrames() - 1;
+	if (target == m_appliedFrame)
+		return true;
+
+	// carry on from the last decoded frame when it is on the way,
+	// otherwise start again from the keyframe at or before the target
+	int keyframe = target - target % m_pHeader->keyframeInterval;
+	int from = keyframe;
+	if (m_decodedFrame >= keyframe && m_decodedFrame <= target)
+		from = m_decodedFrame + 1;
+	for (int frame = from; frame <= target; frame++)
+		DecodeFrame(frame);
+	m_decodedFrame = target;
+
+	// only the bodies that changed are touched. Their collision
+	// transforms are set as well as their motion states, so culling
+	// by body bounds sees them where they are drawn
+	float positionScale = m_pHeader->positionScale;
+	for (int i = 0; i < m_changed.size(); i++) {
+		unsigned int index = m_changed[i];
+		m_isChanged[index] = 0;
+
+		btTransform transform;
+		Dequantize(m_states[index], positionScale, transform);
+
+		Entity &entity = entities.GetEntity(index);
+		entity.pBody->setWorldTransform(transform);
+		entity.pMotionState->setWorldTransform(transform);
+	}
+	m_changed.clear();
+
+	m_appliedFrame = target;
+	return true;
+}
+
+void TrajectoryPlayer::DecodeFrame(int frame) {
+	const unsigned char* pData = m_file.GetData() + m_frames[frame];
+	TrajectoryFrameHeader header;
+	memcpy(&header, pData, sizeof(header));
+
+	const unsigned char* p = pData + sizeof(header);
+	const unsigned char* end = p + header.size;
+
+	uint32_t numBodies = m_pHeader->numBodies;
+	uint32_t index = (uint32_t)-1;
+	for (uint32_t i = 0; i < header.numBodies; i++) {
+		uint32_t skipped;
+		p = GetVarint(p, end, skipped);
+		if (!p || end - p < 1)
+			return;
+		index += skipped + 1;
+
+		unsigned char flags = *p++;
+		bool absolute = (flags & TRAJECTORY_ABSOLUTE) != 0;
+		size_t needed = (absolute ? 3 * sizeof(int32_t) : 3 * sizeof(int16_t)) + 3 * sizeof(int16_t);
+		if (index >= numBodies || (size_t)(end - p) < needed)
+			return;
+
+		TrajectoryBodyState &state = m_states[index];
+		if (absolute) {
+			memcpy(state.position, p, sizeof(state.position));
+			p += sizeof(state.position);
+		} else {
+			for (int j = 0; j < 3; j++) {
+				int16_t delta;
+				memcpy(&delta, p, sizeof(delta));
+				p += sizeof(delta);
+				state.position[j] += delta;
+			}
+		}
+		memcpy(state.rotation, p, sizeof(state.rotation));
+		p += sizeof(state.rotation);
+		state.largest = (uint8_t)((flags >> 1) & 3);
+
+		if (!m_isChanged[index]) {
+			m_isChanged[index] = 1;
+			m_changed.push_back(index);
+		}
+	}
+}
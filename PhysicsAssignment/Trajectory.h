@@ -0,0 +1,190 @@
+#ifndef _TRAJECTORY_H_
+#define _TRAJECTORY_H_
+
+#include "btBulletDynamicsCommon.h"
+
+#include "MappedFile.h"
+#include "EntityStore.h"
+
+#include <cstdio>
+#include <stdint.h>
+#include <vector>
+
+// a recording of every body's transform after every simulation step,
+// so a run can be watched again without simulating it. The file is a
+// header followed by one frame per step:
+//
+//   TrajectoryHeader
+//   TrajectoryFrameHeader, then size bytes of body records	frame 0
+//   TrajectoryFrameHeader, then size bytes of body records	frame 1
+//   ...
+//
+// a frame only holds the bodies whose transform changed since the frame
+// before, so sleeping bodies cost nothing. Every keyframeInterval'th
+// frame, starting with frame 0, holds every body, so playback can jump
+// to any frame by decoding forward from the keyframe before it.
+//
+// a body record is packed into bytes, with no alignment:
+//
+//   varint		bodies skipped since the last record in this frame
+//   uint8		TrajectoryBodyFlags, with the quaternion's largest
+//				component in bits 1 and 2
+//   position	3 x int32 if TRAJECTORY_ABSOLUTE, else 3 x int16 deltas
+//				from the body's last recorded position, in
+//				positionScale units
+//   rotation	3 x int16, the quaternion's other three components
+//
+// the largest component of a unit quaternion is never smaller than the
+// others, so it is left out and rebuilt from them on playback
+
+#define TRAJECTORY_FILE_VERSION 1
+
+// bodies are recorded to a 1/1024th of a unit
+#define TRAJECTORY_DEFAULT_POSITION_SCALE (1.0f / 1024.0f)
+#define TRAJECTORY_DEFAULT_KEYFRAME_INTERVAL 120
+
+enum TrajectoryFrameFlags {
+	TRAJECTORY_KEYFRAME = 1		// every body is recorded, with absolute positions
+};
+
+enum TrajectoryBodyFlags {
+	TRAJECTORY_ABSOLUTE = 1		// the position is absolute, not a delta
+};
+
+struct TrajectoryHeader {
+	char magic[4];				// "DOMT"
+	uint32_t version;
+	uint32_t numBodies;			// entities in the recorded scene, in EntityStore order
+	uint32_t numFrames;			// filled in when the recording is closed
+	uint32_t keyframeInterval;
+	float stepSize;				// simulated seconds per frame
+	float positionScale;		// units per quantized position step
+	uint32_t reserved;
+};
+
+struct TrajectoryFrameHeader {
+	uint32_t size;				// bytes of body records that follow
+	uint32_t numBodies;			// body records in this frame
+	uint32_t flags;				// TrajectoryFrameFlags
+};
+
+// a body's transform as it is stored. Recording and playback both keep
+// the last quantized value of every body, and deltas are taken between
+// those, so rounding never accumulates
+struct TrajectoryBodyState {
+	int32_t position[3];
+	int16_t rotation[3];
+	uint8_t largest;			// which quaternion component was left out
+
+	bool operator==(const TrajectoryBodyState &other) const;
+	bool operator!=(const TrajectoryBodyState &other) const { return !(*this == other); }
+};
+
+// what a recording has cost so far
+struct TrajectoryStats {
+	int frames;
+	int keyframes;
+	unsigned int bodyRecords;
+	unsigned long long bytes;
+
+	TrajectoryStats() : frames(0), keyframes(0), bodyRecords(0), bytes(0) {}
+};
+
+// writes a recording, one frame per simulation step. Hand it to
+// PhysicsSimulation::SetRecorder() and it is fed after every internal step
+class TrajectoryRecorder {
+public:
+	TrajectoryRecorder();
+	~TrajectoryRecorder();
+
+	// start a recording of the entities as they are now, which is
+	// written as frame 0. Prints why and returns false on failure
+	bool Open(const char* path, const EntityStore &entities,
+		int keyframeInterval = TRAJECTORY_DEFAULT_KEYFRAME_INTERVAL,
+		float positionScale = TRAJECTORY_DEFAULT_POSITION_SCALE);
+
+	// finish the header and close the file
+	bool Close();
+
+	bool IsOpen() const { return m_pFile != 0; }
+
+	// append a frame with every body that moved since the last one
+	void RecordStep(const EntityStore &entities, btScalar timeStep);
+
+	// make the next frame a keyframe. For when bodies have been moved
+	// without being woken, such as by a reset
+	void ForceKeyframe();
+
+	const TrajectoryStats& GetStats() const { return m_stats; }
+
+private:
+	void WriteFrame(const EntityStore &entities, bool keyframe);
+
+	FILE* m_pFile;
+	TrajectoryHeader m_header;
+	TrajectoryStats m_stats;
+	bool m_failed;
+	bool m_forceKeyframe;
+
+	// the last recorded state of every body
+	std::vector<TrajectoryBodyState> m_states;
+
+	// the frame being built, kept between frames so it doesn't reallocate
+	std::vector<unsigned char> m_buffer;
+};
+
+// plays a recording back onto the entities of the scene it was recorded
+// from. Nothing is simulated: each frame's body records are decoded and
+// written straight into the bodies' transforms and motion states, and
+// only the bodies in the frame are touched
+class TrajectoryPlayer {
+public:
+	TrajectoryPlayer();
+
+	// map the recording and index its frames. Prints why and returns
+	// false if it isn't a recording this code can read
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return m_pHeader != 0; }
+
+	int GetNumBodies() const { return m_pHeader->numBodies; }
+	int GetNumFrames() const { return (int)m_frames.size(); }
+	float GetStepSize() const { return m_pHeader->stepSize; }
+	float GetDuration() const { return GetNumFrames() * GetStepSize(); }
+
+	// the frame that has been applied, or -1 before the first Apply()
+	int GetFrame() const { return m_appliedFrame; }
+	float GetTime() const { return m_time; }
+
+	// move the playback time, which is clamped to the recording. The
+	// new frame is decoded on the next Apply()
+	void Seek(float time);
+	void Advance(float dt) { Seek(m_time + dt); }
+
+	// write the frame at the playback time into the entities. Returns
+	// false if the recording was made of a different scene
+	bool Apply(EntityStore &entities);
+
+private:
+	// decode one frame into m_states, noting the bodies it changes
+	void DecodeFrame(int frame);
+
+	MappedFile m_file;
+	const TrajectoryHeader* m_pHeader;
+
+	// where each frame's header starts in the file
+	std::vector<size_t> m_frames;
+
+	float m_time;
+	int m_decodedFrame;
+	int m_appliedFrame;
+
+	std::vector<TrajectoryBodyState> m_states;
+
+	// the bodies decoded since the last Apply(), each listed once
+	std::vector<unsigned int> m_changed;
+	std::vector<unsigned char> m_isChanged;
+};
+
+#endif
@@ -0,0 +1,260 @@
+#include "WavefrontActivation.h"
+
+#include <algorithm>
+
+// a domino's long side is its local x axis, which points up while it
+// stands. Leaning more than about 10 degrees means it is on its way down
+#define TIPPING_COS 0.985f
+
+// how slow a fallen domino has to be going before it is frozen
+#define SETTLED_SPEED 0.05f
+
+// goes through the proxies overlapping one domino's, taking out the
+// pairs its broadphase filter no longer allows or adding back the ones
+// it does. The pair cache checks the filters itself before adding
+struct PairUpdater : public btBroadphaseAabbCallback {
+	btBroadphaseProxy* pProxy;
+	btOverlappingPairCache* pCache;
+	btDispatcher* pDispatcher;
+	bool frozen;
+
+	virtual bool process(const btBroadphaseProxy* pConstOther) {
+		btBroadphaseProxy* pOther = const_cast<btBroadphaseProxy*>(pConstOther);
+		if (pOther == pProxy)
+			return true;
+		if (!frozen)
+			pCache->addOverlappingPair(pProxy, pOther);
+		else if (!(pOther->m_collisionFilterGroup & pProxy->m_collisionFilterMask))
+			pCache->removeOverlappingPair(pProxy, pOther, pDispatcher);
+		return true;
+	}
+};
+
+WavefrontActivation::WavefrontActivation()
+:
+m_pWorld(0),
+m_mass(0.0f),
+m_inertia(0.0f, 0.0f, 0.0f)
+{
+}
+
+void WavefrontActivation::Attach(btCollisionWorld* pWorld, const std::vector<btRigidBody*> &dominos, const std::vector<int> &leads, const WavefrontSettings &settings) {
+	m_pWorld = pWorld;
+	m_settings = settings;
+	m_dominos = dominos;
+	m_states.assign(m_dominos.size(), DOMINO_LIVE);
+	m_chains.clear();
+	m_stats = WavefrontStats();
+	if (m_dominos.empty())
+		return;
+
+	m_mass = 1.0f / m_dominos[0]->getInvMass();
+	m_inertia = m_dominos[0]->getLocalInertia();
+
+	// a contact names bodies, so each domino keeps its place in the
+	// order in its second user index, which nothing else uses
+	for (int i = 0; i < m_dominos.size(); i++)
+		m_dominos[i]->setUserIndex2(i);
+
+	// split the dominos into chains at each lead
+	std::vector<int> starts(1, 0);
+	for (int i = 0; i < leads.size(); i++) {
+		if (leads[i] > 0 && leads[i] < m_dominos.size())
+			starts.push_back(leads[i]);
+	}
+	std::sort(starts.begin(), starts.end());
+	starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+	for (int i = 0; i < starts.size(); i++) {
+		Chain chain;
+		chain.first = starts[i];
+		chain.end = i + 1 < starts.size() ? starts[i + 1] : (int)m_dominos.size();
+		m_chains.push_back(chain);
+	}
+
+	m_stats.live = (int)m_dominos.size();
+	m_pairsChanged.reserve(m_dominos.size());
+	StartChains();
+	UpdatePairs();
+}
+
+void WavefrontActivation::StartChains() {
+	for (int c = 0; c < m_chains.size(); c++) {
+		Chain &chain = m_chains[c];
+
+		// each lead is pushed from the start, so it is the first front
+		chain.front = chain.first;
+		chain.retired = chain.first;
+		chain.awakeEnd = std::min(chain.end, chain.first + m_settings.ahead + 1);
+
+		for (int i = chain.first; i < chain.end; i++)
+			SetState(i, i < chain.awakeEnd ? DOMINO_LIVE : DOMINO_DORMANT);
+	}
+}
+
+void WavefrontActivation::Reset() {
+	if (!IsAttached())
+		return;
+	int contactWakes = m_stats.contactWakes;
+	StartChains();
+	m_stats.contactWakes = contactWakes;
+}
+
+void WavefrontActivation::Update() {
+	for (int c = 0; c < m_chains.size(); c++) {
+		Chain &chain = m_chains[c];
+
+		// only the window past the front can have started to tip
+		for (int i = chain.front + 1; i < chain.awakeEnd; i++) {
+			if (m_states[i] == DOMINO_LIVE && IsTipping(i))
+				chain.front = i;
+		}
+
+		// keep the next few ready to be hit
+		while (chain.awakeEnd < chain.end && chain.awakeEnd <= chain.front + m_settings.ahead) {
+			SetState(chain.awakeEnd, DOMINO_LIVE);
+			chain.awakeEnd++;
+		}
+
+		// and freeze the fallen ones in order once they have stopped
+		// moving. One still settling holds up the ones after it
+		while (chain.retired < chain.front - m_settings.behind) {
+			int i = chain.retired;
+			if (m_states[i] == DOMINO_LIVE) {
+				if (!IsSettled(i))
+					break;
+				SetState(i, DOMINO_RETIRED);
+			}
+			chain.retired++;
+		}
+	}
+	UpdatePairs();
+}
+
+void WavefrontActivation::UpdatePairs() {
+	if (m_pairsChanged.empty())
+		return;
+
+	btBroadphaseInterface* pBroadphase = m_pWorld->getBroadphase();
+	PairUpdater updater;
+	updater.pCache = pBroadphase->getOverlappingPairCache();
+	updater.pDispatcher = m_pWorld->getDispatcher();
+
+	// whatever a domino is now decides what its pairs should be, however
+	// many times it was frozen and woken since
+	for (int j = 0; j < m_pairsChanged.size(); j++) {
+		int i = m_pairsChanged[j];
+		updater.pProxy = m_dominos[i]->getBroadphaseHandle();
+		updater.frozen = m_states[i] != DOMINO_LIVE;
+		pBroadphase->aabbTest(updater.pProxy->m_aabbMin, updater.pProxy->m_aabbMax, updater);
+	}
+	m_pairsChanged.clear();
+}
+
+void WavefrontActivation::OnContact(const ContactEvent &event) {
+	if (event.type != CONTACT_BEGIN)
+		return;
+
+	const btCollisionObject* bodies[2] = { event.pBody0, event.pBody1 };
+	for (int b = 0; b < 2; b++) {
+		// the bodies may be gone by the time an end event arrives, but
+		// a begin event's bodies are in the world
+		int i = bodies[b]->getUserIndex2();
+		if (i < 0 || i >= m_dominos.size() || m_dominos[i] != bodies[b] || m_states[i] != DOMINO_DORMANT)
+			continue;
+
+		SetState(i, DOMINO_LIVE);
+		m_stats.contactWakes++;
+
+		// whatever hit it, the chain's front has got this far
+		for (int c = 0; c < m_chains.size(); c++) {
+			Chain &chain = m_chains[c];
+			if (i >= chain.first && i < chain.end && i > chain.front)
+				chain.front = i;
+		}
+	}
+
+	// it is about to be stepped, so it needs its pairs with the ground
+	// and its frozen neighbours back straight away
+	UpdatePairs();
+}
+
+void WavefrontActivation::SetState(int i, DominoState state) {
+	DominoState previous = (DominoState)m_states[i];
+	if (previous == state)
+		return;
+
+	if (previous == DOMINO_LIVE)
+		Freeze(i);
+	else if (state == DOMINO_LIVE)
+		Thaw(i);
+
+	// dormant dominos want to hear about being hit
+	if (state == DOMINO_DORMANT)
+		ContactEventDispatcher::Subscribe(m_dominos[i]);
+	else if (previous == DOMINO_DORMANT)
+		ContactEventDispatcher::Unsubscribe(m_dominos[i]);
+
+	int* counts[3] = { &m_stats.live, &m_stats.dormant, &m_stats.retired };
+	(*counts[previous])--;
+	(*counts[state])++;
+	m_states[i] = (unsigned char)state;
+}
+
+void WavefrontActivation::Freeze(int i) {
+	btRigidBody* pBody = m_dominos[i];
+
+	// no mass makes it immovable to the solver, and static keeps it out
+	// of the islands. Asleep, the world stops updating its bounds, so
+	// they are brought up to date once here, where it stopped
+	pBody->setLinearVelocity(btVector3(0, 0, 0));
+	pBody->setAngularVelocity(btVector3(0, 0, 0));
+	pBody->setMassProps(0.0f, btVector3(0, 0, 0));
+	pBody->setCollisionFlags(pBody->getCollisionFlags() | btCollisionObject::CF_STATIC_OBJECT);
+	pBody->updateInertiaTensor();
+	pBody->forceActivationState(ISLAND_SLEEPING);
+
+	// it may have been drawn part way through its last step
+	if (pBody->getMotionState())
+		pBody->getMotionState()->setWorldTransform(pBody->getWorldTransform());
+	m_pWorld->updateSingleAabb(pBody);
+
+	// like the ground, it is only collided with what isn't static. Its
+	// pairs with the ground and the other frozen dominos would otherwise
+	// stay in the cache, to be visited every step, for as long as they
+	// overlap, so UpdatePairs() takes them out
+	btBroadphaseProxy* pProxy = pBody->getBroadphaseHandle();
+	pProxy->m_collisionFilterGroup = btBroadphaseProxy::StaticFilter;
+	pProxy->m_collisionFilterMask = btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter;
+	m_pairsChanged.push_back(i);
+}
+
+void WavefrontActivation::Thaw(int i) {
+	btRigidBody* pBody = m_dominos[i];
+
+	// it stays asleep until something touches it, which wakes it the
+	// way any sleeping body is woken
+	pBody->setCollisionFlags(pBody->getCollisionFlags() & ~btCollisionObject::CF_STATIC_OBJECT);
+	pBody->setMassProps(m_mass, m_inertia);
+	pBody->updateInertiaTensor();
+	pBody->forceActivationState(ISLAND_SLEEPING);
+	pBody->setDeactivationTime(0.0f);
+
+	// collide with everything again. Nothing has moved, so the
+	// broadphase won't find the pairs by itself, and UpdatePairs()
+	// puts them back
+	btBroadphaseProxy* pProxy = pBody->getBroadphaseHandle();
+	pProxy->m_collisionFilterGroup = btBroadphaseProxy::DefaultFilter;
+	pProxy->m_collisionFilterMask = btBroadphaseProxy::AllFilter;
+	m_pairsChanged.push_back(i);
+}
+
+bool WavefrontActivation::IsTipping(int i) const {
+	return btFabs(m_dominos[i]->getWorldTransform().getBasis()[1][0]) < TIPPING_COS;
+}
+
+bool WavefrontActivation::IsSettled(int i) const {
+	const btRigidBody* pBody = m_dominos[i];
+	return pBody->getLinearVelocity().length2() < SETTLED_SPEED * SETTLED_SPEED
+		&& pBody->getAngularVelocity().length2() < SETTLED_SPEED * SETTLED_SPEED;
+}
@@ -0,0 +1,131 @@
+#ifndef _WAVEFRONTACTIVATION_H_
+#define _WAVEFRONTACTIVATION_H_
+
+#include "btBulletDynamicsCommon.h"
+
+#include "ContactEventDispatcher.h"
+
+#include <vector>
+
+struct WavefrontSettings {
+	bool enabled;
+	int ahead;		// dominos kept simulated past each chain's front
+	int behind;		// dominos left simulated behind the front before the settled ones are frozen
+
+	WavefrontSettings() : enabled(false), ahead(8), behind(16) {}
+};
+
+struct WavefrontStats {
+	int live;
+	int dormant;		// frozen standing, ahead of the front
+	int retired;		// frozen fallen, behind the front
+	int contactWakes;	// dormant dominos woken early by being hit
+
+	WavefrontStats() : live(0), dormant(0), retired(0), contactWakes(0) {}
+};
+
+// keeps only the dominos near each chain's toppling front in the
+// simulation. Even asleep, every dynamic body is carried through the
+// island manager's union-find and sort every step, and the fallen dominos
+// behind the front all lean on each other, so they form one island with
+// the front that never gets to sleep. Both make a step cost more the
+// longer the chain is.
+//
+// dominos far ahead of the front and settled ones far behind it are
+// frozen instead: given no mass and flagged static, in place in the
+// world. A frozen domino is still collided against and drawn, but Bullet
+// treats it like the ground, so it drops out of the islands and the
+// solver. Its broadphase proxy is moved into the static group too, and
+// its pairs with the ground and other frozen dominos are taken out of
+// the pair cache, so the dispatcher stops visiting them. The world
+// should only update the bounds of active bodies, so frozen ones cost
+// nothing there either. Freezing in place rather than removing bodies
+// keeps the world's order, so a WorldSnapshot taken afterwards still
+// restores.
+//
+// the front is the furthest domino in each chain that has started to
+// tip, found by checking the few simulated dominos ahead of the front
+// after every step, so the cost per step depends on the window rather
+// than on the chain. A frozen domino that gets hit anyway, by something
+// going off the expected path, is woken by its contact event
+class WavefrontActivation {
+public:
+	WavefrontActivation();
+
+	// take charge of the dominos in pWorld, in toppling order, with leads
+	// listing the first domino of each chain. The first domino always
+	// starts a chain. Everything more than settings.ahead past a chain's
+	// start is frozen straight away
+	void Attach(btCollisionWorld* pWorld, const std::vector<btRigidBody*> &dominos, const std::vector<int> &leads, const WavefrontSettings &settings);
+
+	bool IsAttached() const { return !m_dominos.empty(); }
+
+	// move the fronts on, then wake and freeze to match. Called after
+	// every internal step
+	void Update();
+
+	// wake a frozen domino that has been hit
+	void OnContact(const ContactEvent &event);
+
+	// wake and freeze everything back to how Attach() left it. The pairs
+	// aren't updated until UpdatePairs(), so the bodies can be put back
+	// where they were first
+	void Reset();
+
+	// take the pairs of dominos frozen since the last call out of the
+	// pair cache, and put back those of dominos woken since. Update()
+	// and OnContact() do this themselves
+	void UpdatePairs();
+
+	// the furthest domino of each chain that has started to tip
+	int GetNumChains() const { return (int)m_chains.size(); }
+	int GetFront(int chain) const { return m_chains[chain].front; }
+
+	const WavefrontStats& GetStats() const { return m_stats; }
+
+private:
+	enum DominoState {
+		DOMINO_LIVE,
+		DOMINO_DORMANT,
+		DOMINO_RETIRED
+	};
+
+	// a run of dominos, [first, end), that topple one after another.
+	// Everything before retired is frozen or still settling, everything
+	// from awakeEnd on is dormant
+	struct Chain {
+		int first;
+		int end;
+		int front;
+		int awakeEnd;
+		int retired;
+	};
+
+	void Freeze(int i);
+	void Thaw(int i);
+	void SetState(int i, DominoState state);
+
+	bool IsTipping(int i) const;
+	bool IsSettled(int i) const;
+
+	// the chains as Attach() set them up, for Reset()
+	void StartChains();
+
+	WavefrontSettings m_settings;
+	WavefrontStats m_stats;
+
+	btCollisionWorld* m_pWorld;
+
+	std::vector<btRigidBody*> m_dominos;
+	std::vector<unsigned char> m_states;
+	std::vector<Chain> m_chains;
+
+	// dominos frozen or woken since the last UpdatePairs()
+	std::vector<int> m_pairsChanged;
+
+	// every domino has the same mass, kept here while they are frozen
+	btScalar m_mass;
+	btVector3 m_inertia;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "WorldSnapshot.h"
+
+WorldSnapshot::WorldSnapshot() {
+}
+
+void WorldSnapshot::Capture(btDynamicsWorld* pWorld) {
+	// the bodies, in the world's own order
+	btCollisionObjectArray &objects = pWorld->getCollisionObjectArray();
+	m_bodies.resize(objects.size());
+	for (int i = 0; i < objects.size(); i++) {
+		btCollisionObject* pObject = objects[i];
+		BodyState &state = m_bodies[i];
+		state.pObject = pObject;
+		state.transform = pObject->getWorldTransform();
+		state.activationState = pObject->getActivationState();
+		state.deactivationTime = pObject->getDeactivationTime();
+
+		btRigidBody* pBody = btRigidBody::upcast(pObject);
+		state.linearVelocity = pBody ? pBody->getLinearVelocity() : btVector3(0,0,0);
+		state.angularVelocity = pBody ? pBody->getAngularVelocity() : btVector3(0,0,0);
+	}
+}
+
+bool WorldSnapshot::Restore(btDynamicsWorld* pWorld) const {
+	// check the world still holds the same bodies before touching any of them
+	btCollisionObjectArray &objects = pWorld->getCollisionObjectArray();
+	if (objects.size() != m_bodies.size())
+		return false;
+	for (int i = 0; i < objects.size(); i++) {
+		if (objects[i] != m_bodies[i].pObject)
+			return false;
+	}
+
+	for (int i = 0; i < m_bodies.size(); i++) {
+		const BodyState &state = m_bodies[i];
+		btCollisionObject* pObject = state.pObject;
+
+		btRigidBody* pBody = btRigidBody::upcast(pObject);
+		if (pBody) {
+			// this also resets the interpolation transform
+			// and the body's world space inertia
+			pBody->setCenterOfMassTransform(state.transform);
+			pBody->setLinearVelocity(state.linearVelocity);
+			pBody->setAngularVelocity(state.angularVelocity);
+			pBody->setInterpolationLinearVelocity(state.linearVelocity);
+			pBody->setInterpolationAngularVelocity(state.angularVelocity);
+			pBody->clearForces();
+
+			// Bullet won't tell a sleeping body's motion state it has
+			// moved, so tell it here
+			if (pBody->getMotionState())
+				pBody->getMotionState()->setWorldTransform(state.transform);
+		} else {
+			pObject->setWorldTransform(state.transform);
+			pObject->setInterpolationWorldTransform(state.transform);
+		}
+
+		pObject->forceActivationState(state.activationState);
+		pObject->setDeactivationTime(state.deactivationTime);
+	}
+
+	// the contacts, and the impulses the solver would warm start from,
+	// belong to where the bodies were. The manifolds are emptied and
+	// refill on the next step, from the restored positions
+	btDispatcher* pDispatcher = pWorld->getDispatcher();
+	for (int i = 0; i < pDispatcher->getNumManifolds(); i++)
+		pDispatcher->getManifoldByIndexInternal(i)->clearManifold();
+
+	// the bodies have moved, so the broadphase needs their new bounds,
+	// including those of bodies put back to sleep, which the world may
+	// have been told to leave alone
+	bool forceUpdateAll = pWorld->getForceUpdateAllAabbs();
+	pWorld->setForceUpdateAllAabbs(true);
+	pWorld->updateAabbs();
+	pWorld->setForceUpdateAllAabbs(forceUpdateAll);
+	return true;
+}
+
+size_t WorldSnapshot::GetBytesUsed() const {
+	return m_bodies.capacity() * sizeof(BodyState);
+}
@@ -0,0 +1,49 @@
+#ifndef _WORLDSNAPSHOT_H_
+#define _WORLDSNAPSHOT_H_
+
+#include "btBulletDynamicsCommon.h"
+
+// a copy of the moving state of every body in a world, which can be put
+// back later. Restoring writes the saved values straight over the bodies
+// already in the world, so nothing is added to or removed from the
+// broadphase and nothing is allocated. It only works while the world
+// holds the same bodies in the same order as when it was captured.
+//
+// contact points aren't saved. A scene is captured as it is built,
+// before its first step has made any, so restoring empties every
+// manifold instead, and the solver starts over without warm starting
+// just as it did the first time
+class WorldSnapshot {
+public:
+	WorldSnapshot();
+
+	// save the state of every body in the world
+	void Capture(btDynamicsWorld* pWorld);
+
+	// put the world back as it was captured. Returns false, leaving the
+	// world alone, if bodies have been added or removed since
+	bool Restore(btDynamicsWorld* pWorld) const;
+
+	bool IsEmpty() const { return m_bodies.size() == 0; }
+	int GetNumBodies() const { return (int)m_bodies.size(); }
+
+	// memory held by the snapshot
+	size_t GetBytesUsed() const;
+
+private:
+	struct BodyState {
+		btTransform transform;
+		btVector3 linearVelocity;
+		btVector3 angularVelocity;
+		btCollisionObject* pObject;
+		int activationState;
+		btScalar deactivationTime;
+
+		BT_DECLARE_ALIGNED_ALLOCATOR();
+	};
+
+	// kept in world order so restoring is one linear pass
+	btAlignedObjectArray<BodyState> m_bodies;
+};
+
+#endif
@@ -1,8 +1,80 @@
 #include "BulletOpenGLApplication.h"
 #include "FreeGLUTCallbacks.h"
 
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
 int main(int argc, char** argv)
 {
 	BulletOpenGLApplication demo;
+
+	// an optional scene file to load instead of the demo scene, then
+	// optionally a file to record the run to or a recording to play
+	if (argc > 1 && argv[1][0] != '-' && !demo.LoadScene(argv[1]))
+		return 1;
+
+	// --offscreen renders without a window and saves every frame
+	const char* offscreenPrefix = 0;
+	int frames = 600;
+	int width = 1024;
+	int height = 768;
+
+	// how the world is stepped, on the physics thread or not
+	TimeStepSettings timeStep;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			demo.RecordTo(argv[++i]);
+		} else if (strcmp(argv[i], "--play") == 0 && i + 1 < argc) {
+			if (!demo.LoadRecording(argv[++i]))
+				return 1;
+		} else if (strcmp(argv[i], "--physics-thread") == 0) {
+			demo.SetPhysicsThread(true);
+		} else if (strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+			timeStep.step = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i], "--max-substeps") == 0 && i + 1 < argc) {
+			timeStep.maxSubSteps = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--adaptive") == 0) {
+			timeStep.mode = TIMESTEP_ADAPTIVE;
+		} else if (strcmp(argv[i], "--wavefront") == 0) {
+			WavefrontSettings wavefront;
+			wavefront.enabled = true;
+			demo.SetWavefront(wavefront);
+		} else if (strcmp(argv[i], "--broadphase") == 0 && i + 1 < argc) {
+			BroadphaseSettings broadphase;
+			if (!ParseBroadphaseName(argv[++i], broadphase.type)) {
+				fprintf(stderr, "unknown broadphase '%s'\n", argv[i]);
+				return 1;
+			}
+			demo.SetBroadphase(broadphase);
+		} else if (strcmp(argv[i], "--solver") == 0 && i + 1 < argc) {
+			SolverProfile profile;
+			if (!ParseSolverProfileName(argv[++i], profile)) {
+				fprintf(stderr, "unknown solver profile '%s'\n", argv[i]);
+				return 1;
+			}
+			demo.SetSolver(GetSolverProfile(profile));
+		} else if (strcmp(argv[i], "--no-ccd") == 0) {
+			CcdSettings ccd;
+			ccd.enabled = false;
+			demo.SetCcd(ccd);
+		} else if (strcmp(argv[i], "--no-interpolation") == 0) {
+			timeStep.interpolate = false;
+		} else if (strcmp(argv[i], "--offscreen") == 0 && i + 1 < argc) {
+			offscreenPrefix = argv[++i];
+		} else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &width, &height) != 2)
+				return 1;
+		}
+	}
+
+	demo.SetTimeStep(timeStep);
+
+	if (offscreenPrefix)
+		return demo.RunOffscreen(offscreenPrefix, width, height, frames) ? 0 : 1;
+
 	return glutmain(argc, argv, 1024, 768, "Domino Simulation Using Bullet Physics Engine", &demo);
 }
\ No newline at end of file